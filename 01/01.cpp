@@ -1,30 +1,361 @@
 #include <iostream>
 #include <vector>
-#include <map>
+#include <array>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <queue>
 
 using namespace std;
-int N=1000;
 
-int main(){
+// Run f(0..threads-1), one call per thread
+template <class F>
+void run_threads(int threads, F f){
+    vector<thread> pool;
+    for (int t=1; t<threads; t++) pool.emplace_back(f, t);
+    f(0);
+    for (auto& th:pool) th.join();
+}
+
+// Radix digit, sign bit flipped so negative keys sort first
+inline unsigned digit(int x, int shift){
+    return (((unsigned) x ^ 0x80000000u) >> shift) & 0xFF;
+}
+
+// LSD radix sort on 32-bit keys, 8 bits per pass
+void radix_sort(vector<int>& a, int threads){
+    size_t n = a.size();
+    if (n < 2) return;
+    threads = max(1, (int) min<size_t>(threads, n/65536 + 1));
+
+    vector<int> tmp(n);
+    vector<array<size_t, 256>> cnt(threads);
+    int *src = a.data(), *dst = tmp.data();
+    auto lo = [&](int t){ return n*t/threads; };
+
+    for (int shift=0; shift<32; shift+=8){
+        run_threads(threads, [&](int t){
+            auto& c = cnt[t];
+            c.fill(0);
+            for (size_t i=lo(t); i<lo(t+1); i++) c[digit(src[i], shift)]++;
+        });
+
+        // Every key has the same digit: pass would be a copy
+        size_t first = 0;
+        for (int t=0; t<threads; t++) first += cnt[t][digit(src[0], shift)];
+        if (first == n) continue;
+
+        size_t off = 0;
+        for (int d=0; d<256; d++){
+            for (int t=0; t<threads; t++){
+                size_t c = cnt[t][d];
+                cnt[t][d] = off;
+                off += c;
+            }
+        }
+
+        run_threads(threads, [&](int t){
+            auto& o = cnt[t];
+            for (size_t i=lo(t); i<lo(t+1); i++) dst[o[digit(src[i], shift)]++] = src[i];
+        });
+        swap(src, dst);
+    }
+    if (src != a.data()) copy(src, src+n, a.data());
+}
+
+// Sort both lists at once, splitting the threads between them
+void sort_both(vector<int>& a, vector<int>& b, int threads){
+    if (threads < 2){
+        radix_sort(a, 1);
+        radix_sort(b, 1);
+        return;
+    }
+    thread tb([&]{ radix_sort(b, threads/2); });
+    radix_sort(a, threads - threads/2);
+    tb.join();
+}
+
+// Part 1 distance and part 2 similarity in one pass over the sorted lists
+pair<long long, long long> merge_join(const vector<int>& a, const vector<int>& b){
+    long long dist = 0, sim = 0;
+    size_t j = 0, run = 0;
+    for (size_t i=0; i<a.size(); i++){
+        if (i < b.size()) dist += llabs((long long) a[i]-b[i]);
+
+        // run = occurrences of a[i] in b, reused for repeated a values
+        if (i == 0 || a[i] != a[i-1]){
+            while (j < b.size() && b[j] < a[i]) j++;
+            run = 0;
+            while (j < b.size() && b[j] == a[i]){
+                j++;
+                run++;
+            }
+        }
+        sim += (long long) a[i]*run;
+    }
+    return {dist, sim};
+}
+
+// Sorted run of ints at a known offset in a temp file. All runs of a
+// column share one file, so spilling takes one descriptor per column.
+struct Run {
+    FILE* f;
+    size_t off, len;
+};
+
+// Ints per merge buffer; every buffer is charged to the -m budget
+const size_t RUN_BUF = 1 << 14;
+
+// A run read back through a buffer. Each reader keeps its own offset so
+// several cursors can share a file.
+struct RunReader {
+    FILE* f;
+    size_t off, stop;
+    vector<int> buf;
+    size_t pos = 0, end = 0;
+
+    RunReader(const Run& r) : f(r.f), off(r.off), stop(r.off+r.len), buf(RUN_BUF) {}
+
+    bool next(int& x){
+        if (pos == end){
+            if (off == stop) return false;
+            fseek(f, (long) (off*sizeof(int)), SEEK_SET);
+            end = fread(buf.data(), sizeof(int), min(buf.size(), stop-off), f);
+            if (end == 0) return false;
+            off += end;
+            pos = 0;
+        }
+        x = buf[pos++];
+        return true;
+    }
+};
+
+// K-way merge over sorted runs
+struct RunMerger {
+    vector<RunReader> readers;
+    priority_queue<pair<int, size_t>, vector<pair<int, size_t>>, greater<>> heap;
+
+    RunMerger(const Run* first, const Run* last){
+        for (auto r=first; r!=last; r++) readers.emplace_back(*r);
+        for (size_t k=0; k<readers.size(); k++){
+            int x;
+            if (readers[k].next(x)) heap.push({x, k});
+        }
+    }
+
+    bool next(int& x){
+        if (heap.empty()) return false;
+        auto [v, k] = heap.top();
+        heap.pop();
+        x = v;
+        if (readers[k].next(v)) heap.push({v, k});
+        return true;
+    }
+};
+
+FILE* temp_file(){
+    FILE* f = tmpfile();
+    if (!f){
+        cerr << "Error: Could not write temp run.\n";
+        exit(1);
+    }
+    return f;
+}
+
+void write_ints(const int* v, size_t n, FILE* f){
+    if (fwrite(v, sizeof(int), n, f) != n){
+        cerr << "Error: Could not write temp run.\n";
+        exit(1);
+    }
+}
+
+// Append v as a new run at the end of f
+void spill(const vector<int>& v, FILE* f, vector<Run>& runs){
+    size_t off = runs.empty() ? 0 : runs.back().off + runs.back().len;
+    fseek(f, (long) (off*sizeof(int)), SEEK_SET);
+    write_ints(v.data(), v.size(), f);
+    runs.push_back({f, off, v.size()});
+}
+
+// Merge passes of at most fan_in runs each, into a fresh file per pass,
+// until no more than fan_in runs are left. Takes fan_in + 1 buffers.
+void reduce_runs(vector<Run>& runs, size_t fan_in){
+    while (runs.size() > fan_in){
+        FILE* out = temp_file();
+        vector<Run> merged;
+        vector<int> buf;
+        buf.reserve(RUN_BUF);
+        size_t off = 0;
+        for (size_t i=0; i<runs.size(); i+=fan_in){
+            RunMerger m(&runs[i], &runs[min(i+fan_in, runs.size())]);
+            size_t len = 0;
+            int x;
+            while (m.next(x)){
+                buf.push_back(x);
+                if (buf.size() == RUN_BUF){
+                    write_ints(buf.data(), buf.size(), out);
+                    len += buf.size();
+                    buf.clear();
+                }
+            }
+            write_ints(buf.data(), buf.size(), out);
+            len += buf.size();
+            buf.clear();
+            merged.push_back({out, off, len});
+            off += len;
+        }
+        fclose(runs[0].f);
+        runs = merged;
+    }
+}
+
+// Same as merge_join, over the merged runs of both columns. b is read by
+// two cursors: one index-aligned with a, one advanced by value.
+pair<long long, long long> merge_runs(const vector<Run>& ra, const vector<Run>& rb){
+    RunMerger ma(ra.data(), ra.data()+ra.size());
+    RunMerger mb(rb.data(), rb.data()+rb.size()), mv(rb.data(), rb.data()+rb.size());
+    long long dist = 0, sim = 0;
+    size_t run = 0;
+    bool first = true;
+    int x, y, v, prev = 0;
+    bool has_v = mv.next(v);
+    while (ma.next(x)){
+        if (mb.next(y)) dist += llabs((long long) x-y);
+
+        if (first || x != prev){
+            while (has_v && v < x) has_v = mv.next(v);
+            run = 0;
+            while (has_v && v == x){
+                run++;
+                has_v = mv.next(v);
+            }
+        }
+        first = false;
+        prev = x;
+        sim += (long long) x*run;
+    }
+    return {dist, sim};
+}
+
+// Read pairs from stdin within a budget of `bytes`. Sorting takes 16 bytes
+// per pair (a, b and the radix scratch), so sorted runs are spilled once
+// bytes/16 pairs are held. The merge then fits its buffers in the same
+// budget: each column is first merged down to fan_in runs so the final
+// merge, with one cursor per run of a and two per run of b, needs at most
+// 3 * fan_in buffers.
+pair<long long, long long> stream(size_t bytes, int threads){
+    size_t budget = max<size_t>(1, bytes/16);
+    size_t fan_in = max<size_t>(2, bytes/(RUN_BUF*sizeof(int))/3);
+
     vector<int> a, b;
-    for (int i=0; i<N; i++){
-        int x, y;
-        cin >> x >> y;
+    a.reserve(budget);
+    b.reserve(budget);
+    vector<Run> ra, rb;
+    FILE *fa = nullptr, *fb = nullptr;
+    int x, y;
+    while (cin >> x >> y){
         a.push_back(x);
         b.push_back(y);
+        if (a.size() == budget){
+            sort_both(a, b, threads);
+            if (!fa){
+                fa = temp_file();
+                fb = temp_file();
+            }
+            spill(a, fa, ra);
+            spill(b, fb, rb);
+            a.clear();
+            b.clear();
+        }
     }
-    sort(a.begin(), a.end()); 
-    sort(b.begin(), b.end()); 
+    sort_both(a, b, threads);
+    if (ra.empty()) return merge_join(a, b);
 
-    map<int, int> freq;
-    for (int x:b){
-        freq[x]++;
+    if (!a.empty()){
+        spill(a, fa, ra);
+        spill(b, fb, rb);
     }
-    long long sum = 0;
-    for (int x:a){
-    // for (int i=0; i < N; i++){
-        // sum += abs (a[i]-b[i]) Part 1
-        sum += (long long) x*freq[x];
+    vector<int>().swap(a);
+    vector<int>().swap(b);
+
+    reduce_runs(ra, fan_in);
+    reduce_runs(rb, fan_in);
+    auto result = merge_runs(ra, rb);
+    fclose(ra[0].f);
+    fclose(rb[0].f);
+    return result;
+}
+
+// Radix sort vs std::sort on two random lists of n entries each
+void bench(int threads){
+    mt19937 rng(2024);
+    for (size_t n : {1000000, 10000000, 100000000}){
+        vector<int> a(n), b(n);
+        for (size_t i=0; i<n; i++){
+            a[i] = rng();
+            b[i] = rng();
+        }
+        auto sa = a, sb = b;
+
+        auto t0 = chrono::steady_clock::now();
+        sort(sa.begin(), sa.end());
+        sort(sb.begin(), sb.end());
+        auto t1 = chrono::steady_clock::now();
+        sort_both(a, b, threads);
+        auto t2 = chrono::steady_clock::now();
+
+        if (a != sa || b != sb){
+            cerr << "radix sort mismatch at n=" << n << "\n";
+            exit(1);
+        }
+        cout << "n=" << n
+             << " std::sort " << chrono::duration<double, milli>(t1-t0).count() << "ms"
+             << " radix(" << threads << ") " << chrono::duration<double, milli>(t2-t1).count() << "ms\n";
+    }
+}
+
+// Usage: 01 [-j threads] [-m budget_mb] [--bench] < input
+int main(int argc, char* argv[]){
+    ios::sync_with_stdio(false);
+    int threads = max(1u, thread::hardware_concurrency());
+    size_t budget_mb = 0;
+    bool run_bench = false;
+    for (int i=1; i<argc; i++){
+        string arg = argv[i];
+        if (arg == "--bench") run_bench = true;
+        else if (arg == "-j" && i+1 < argc) threads = max(1, stoi(argv[++i]));
+        else if (arg == "-m" && i+1 < argc) budget_mb = stoull(argv[++i]);
+        else {
+            cerr << "Usage: " << argv[0] << " [-j threads] [-m budget_mb] [--bench]\n";
+            return 1;
+        }
     }
-    cout << sum << "\n";
+    if (run_bench){
+        bench(threads);
+        return 0;
+    }
+
+    // Streaming mode: sort buffers and merge buffers both fit in budget_mb
+    if (budget_mb > 0){
+        auto [dist, sim] = stream(budget_mb << 20, threads);
+        cout << dist << "\n";
+        cout << sim << "\n";
+        return 0;
+    }
+
+    vector<int> a, b;
+    int x, y;
+    while (cin >> x >> y){
+        a.push_back(x);
+        b.push_back(y);
+    }
+    sort_both(a, b, threads);
+
+    auto [dist, sim] = merge_join(a, b);
+    cout << dist << "\n";
+    cout << sim << "\n";
 }
@@ -1,96 +1,481 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
-#include <cmath>
+#include <array>
 #include <algorithm>
 #include <string>
+#include <atomic>
+#include <thread>
+#include <charconv>
+#include <chrono>
+#include <stdexcept>
 
+#include "../common/digits.h"
+#include "../common/mapped_file.h"
+
+// Equation whose operands are the span [offset, offset + len) of
+// Input::operands, in input order
 struct Test {
     uint64_t test_val;
+    uint32_t offset, len;
+};
+
+struct Input {
+    std::vector<Test> tests;
     std::vector<uint64_t> operands;
 };
 
-std::vector<uint64_t> eval_operators(const std::vector<uint64_t>& operands, bool use_concat) {
-    if (operands.empty()) {
+// 10^digits(x), what concatenating x scales the left side by. 0 for 20-digit
+// x, whose concatenations can never fit in 64 bits.
+constexpr uint64_t concat_scale(uint64_t x) {
+    uint32_t d = digits(x);
+    return d < POW10.size() ? POW10[d] : 0;
+}
+
+// Reusable result buffers, one per thread
+struct Scratch {
+    std::vector<uint64_t> cur, next;
+};
+
+// Runtime-flag evaluators below are the --bench baseline for the
+// compile-time specialized ones further down.
+
+// Build every result level by level into scratch; no allocation once the
+// buffers have grown to size
+const std::vector<uint64_t>& eval_operators(const uint64_t* operands, size_t n, bool use_concat, Scratch& scratch) {
+    if (n == 0) {
         throw std::runtime_error("No operands");
     }
 
-    auto head = operands[0];
-    std::vector<uint64_t> tail(operands.begin() + 1, operands.end());
+    auto& cur = scratch.cur;
+    auto& next = scratch.next;
+    cur.assign(1, operands[0]);
+
+    for (size_t i = 1; i < n; ++i) {
+        auto x = operands[i];
+        auto p = concat_scale(x);
+
+        next.clear();
+        for (auto r : cur) {
+            next.push_back(r + x);
+            next.push_back(r * x);
+
+            if (!use_concat || p == 0) continue;
 
-    if (tail.empty()) {
-        return {head};
+            // Concatenation
+            next.push_back(r * p + x);
+        }
+        std::swap(cur, next);
     }
 
-    std::vector<uint64_t> results;
-    for (const auto& r : eval_operators(tail, use_concat)) {
-        results.push_back(head + r);
-        results.push_back(head * r);
+    return cur;
+}
 
-        if (!use_concat) continue;
+// Work backwards from the target, undoing the last operator at each step
+bool solvable(uint64_t target, const uint64_t* operands, size_t n, bool use_concat) {
+    auto x = operands[n - 1];
+    if (n == 1) {
+        return target == x;
+    }
 
-        // Concatenation
-        uint32_t digits = static_cast<uint32_t>(std::floor(std::log10(head)) + 1);
-        uint64_t concat = r * static_cast<uint64_t>(std::pow(10, digits)) + head;
-        results.push_back(concat);
+    // Concatenation: target must end in the digits of x
+    if (use_concat) {
+        auto p = concat_scale(x);
+        if (p != 0 && target % p == x && solvable(target / p, operands, n - 1, use_concat)) {
+            return true;
+        }
     }
 
-    return results;
+    // Multiplication: target must be divisible by x
+    if (x == 0 ? target == 0 : target % x == 0) {
+        if (x == 0 || solvable(target / x, operands, n - 1, use_concat)) {
+            return true;
+        }
+    }
+
+    // Addition: x must not exceed target
+    return target >= x && solvable(target - x, operands, n - 1, use_concat);
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <input_file>" << std::endl;
-        return 1;
+// Right-hand operand with its concatenation scale precomputed
+struct Operand {
+    uint64_t value, pow10;
+
+    explicit Operand(uint64_t x) : value(x), pow10(concat_scale(x)) {}
+};
+
+// Result of undoing `r op x = target`
+enum class Undo { None, Value, Any };
+
+// Operator policies. apply() computes r op x and returns false when it is
+// undefined; total says it never is. undo() recovers r from the target when
+// the operator is invertible (Div is forward-only).
+struct Add {
+    static constexpr bool total = true;
+    static bool apply(uint64_t r, const Operand& x, uint64_t& out) { out = r + x.value; return true; }
+    static Undo undo(uint64_t t, const Operand& x, uint64_t& r) {
+        if (t < x.value) return Undo::None;
+        r = t - x.value;
+        return Undo::Value;
     }
+};
 
-    std::ifstream file(argv[1]);
-    if (!file) {
-        std::cerr << "Error reading file: " << argv[1] << std::endl;
-        return 1;
+struct Mul {
+    static constexpr bool total = true;
+    static bool apply(uint64_t r, const Operand& x, uint64_t& out) { out = r * x.value; return true; }
+    static Undo undo(uint64_t t, const Operand& x, uint64_t& r) {
+        if (x.value == 0) return t == 0 ? Undo::Any : Undo::None;
+        if (t % x.value != 0) return Undo::None;
+        r = t / x.value;
+        return Undo::Value;
     }
+};
 
-    std::vector<Test> tests;
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string test_val_str, operands_str;
-
-        if (std::getline(iss, test_val_str, ':') && std::getline(iss, operands_str)) {
-            Test t;
-            t.test_val = std::stoull(test_val_str);
-
-            std::istringstream operands_stream(operands_str);
-            std::string operand;
-            while (std::getline(operands_stream, operand, ' ')) {
-                if (!operand.empty()) {
-                    t.operands.push_back(std::stoull(operand));
+struct Concat {
+    static constexpr bool total = false;
+    static bool apply(uint64_t r, const Operand& x, uint64_t& out) {
+        if (x.pow10 == 0) return false;
+        out = r * x.pow10 + x.value;
+        return true;
+    }
+    static Undo undo(uint64_t t, const Operand& x, uint64_t& r) {
+        if (x.pow10 == 0 || t % x.pow10 != x.value) return Undo::None;
+        r = t / x.pow10;
+        return Undo::Value;
+    }
+};
+
+struct Sub {
+    static constexpr bool total = false;
+    static bool apply(uint64_t r, const Operand& x, uint64_t& out) {
+        if (r < x.value) return false;
+        out = r - x.value;
+        return true;
+    }
+    static Undo undo(uint64_t t, const Operand& x, uint64_t& r) {
+        r = t + x.value;
+        return r < t ? Undo::None : Undo::Value;
+    }
+};
+
+struct Div {
+    static constexpr bool total = false;
+    static bool apply(uint64_t r, const Operand& x, uint64_t& out) {
+        if (x.value == 0) return false;
+        out = r / x.value;
+        return true;
+    }
+};
+
+struct Xor {
+    static constexpr bool total = true;
+    static bool apply(uint64_t r, const Operand& x, uint64_t& out) { out = r ^ x.value; return true; }
+    static Undo undo(uint64_t t, const Operand& x, uint64_t& r) {
+        r = t ^ x.value;
+        return Undo::Value;
+    }
+};
+
+// eval_operators specialized on an operator set
+template <class... Ops>
+const std::vector<uint64_t>& eval_ops(const uint64_t* operands, size_t n, Scratch& scratch) {
+    if (n == 0) {
+        throw std::runtime_error("No operands");
+    }
+
+    auto& cur = scratch.cur;
+    auto& next = scratch.next;
+    cur.assign(1, operands[0]);
+
+    for (size_t i = 1; i < n; ++i) {
+        Operand x(operands[i]);
+
+        next.clear();
+        for (auto r : cur) {
+            uint64_t v;
+            ((Ops::apply(r, x, v) ? next.push_back(v) : void()), ...);
+        }
+        std::swap(cur, next);
+    }
+
+    return cur;
+}
+
+template <class... Ops>
+bool enumerate_ops(uint64_t target, const uint64_t* operands, size_t n) {
+    thread_local Scratch scratch;
+    auto& results = eval_ops<Ops...>(operands, n, scratch);
+    return std::find(results.begin(), results.end(), target) != results.end();
+}
+
+// Whether n operands evaluate to anything at all, searching depth-first and
+// stopping at the first complete evaluation
+template <class... Ops>
+bool evaluates(uint64_t r, const uint64_t* operands, size_t n) {
+    if (n == 0) return true;
+    Operand x(operands[0]);
+    auto step = [&](auto op) {
+        uint64_t v;
+        return decltype(op)::apply(r, x, v) && evaluates<Ops...>(v, operands + 1, n - 1);
+    };
+    return (step(Ops{}) || ...);
+}
+
+// Any left-hand value works, as long as the operands evaluate at all, which
+// they always do when one of the operators is total
+template <class... Ops>
+bool any_result(const uint64_t* operands, size_t n) {
+    if constexpr ((Ops::total || ...)) {
+        return true;
+    } else {
+        return evaluates<Ops...>(operands[0], operands + 1, n - 1);
+    }
+}
+
+// solvable specialized on an operator set; every operator needs undo().
+// Operators are tried in order, so list the most selective first.
+template <class... Ops>
+bool solve_ops(uint64_t target, const uint64_t* operands, size_t n) {
+    auto x = operands[n - 1];
+    if (n == 1) {
+        return target == x;
+    }
+
+    Operand o(x);
+    auto step = [&](auto op) {
+        uint64_t r;
+        switch (decltype(op)::undo(target, o, r)) {
+        case Undo::Value:
+            return solve_ops<Ops...>(r, operands, n - 1);
+        case Undo::Any:
+            return any_result<Ops...>(operands, n - 1);
+        default:
+            return false;
+        }
+    };
+    return (step(Ops{}) || ...);
+}
+
+using Check = bool (*)(uint64_t target, const uint64_t* operands, size_t n);
+
+// Part 1 and part 2 checks
+struct Solver {
+    Check part1, part2;
+};
+
+constexpr Solver BACKWARD = {solve_ops<Mul, Add>, solve_ops<Concat, Mul, Add>};
+constexpr Solver ENUMERATE = {enumerate_ops<Add, Mul>, enumerate_ops<Add, Mul, Concat>};
+
+// Parse "target: a b c ..." lines straight from the mapped bytes
+Input parse(const char* p, const char* end) {
+    Input input;
+    auto skip_spaces = [&] {
+        while (p < end && (*p == ' ' || *p == '\r')) ++p;
+    };
+
+    while (p < end) {
+        Test t;
+        auto [q, ec] = std::from_chars(p, end, t.test_val);
+        if (ec != std::errc() || q == end || *q != ':') {
+            throw std::runtime_error("Invalid input");
+        }
+        p = q + 1;
+        t.offset = static_cast<uint32_t>(input.operands.size());
+
+        skip_spaces();
+        while (p < end && *p != '\n') {
+            uint64_t x;
+            auto [q, ec] = std::from_chars(p, end, x);
+            if (ec != std::errc()) {
+                throw std::runtime_error("Invalid input");
+            }
+            input.operands.push_back(x);
+            p = q;
+            skip_spaces();
+        }
+        if (p < end) ++p;
+
+        t.len = static_cast<uint32_t>(input.operands.size() - t.offset);
+        if (t.len == 0) {
+            throw std::runtime_error("No operands");
+        }
+        input.tests.push_back(t);
+    }
+    return input;
+}
+
+// Work-stealing pool over the indices [0, n). Each worker owns a range packed
+// as lo | hi << 32, takes items from its front and, once it runs dry, steals
+// the back half of another worker's range.
+class StealPool {
+public:
+    explicit StealPool(size_t workers) : ranges_(workers) {}
+
+    template <class F>
+    void run(uint32_t n, F f) {
+        size_t workers = ranges_.size();
+        for (size_t w = 0; w < workers; ++w) {
+            ranges_[w].store(pack(n * w / workers, n * (w + 1) / workers));
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t w = 1; w < workers; ++w) {
+            threads.emplace_back([this, w, &f] { work(w, f); });
+        }
+        work(0, f);
+        for (auto& t : threads) t.join();
+    }
+
+private:
+    static uint64_t pack(uint64_t lo, uint64_t hi) { return lo | hi << 32; }
+    static uint32_t lo(uint64_t r) { return static_cast<uint32_t>(r); }
+    static uint32_t hi(uint64_t r) { return static_cast<uint32_t>(r >> 32); }
+
+    template <class F>
+    void work(size_t self, F& f) {
+        auto& own = ranges_[self];
+        for (;;) {
+            uint64_t r = own.load();
+            while (lo(r) < hi(r)) {
+                if (own.compare_exchange_weak(r, pack(lo(r) + 1, hi(r)))) {
+                    f(self, lo(r));
                 }
             }
-            std::reverse(t.operands.begin(), t.operands.end());
-            tests.push_back(t);
-        } else {
-            throw std::runtime_error("Invalid input");
+            if (!steal(self)) return;
         }
     }
 
-    uint64_t sum1 = 0;
-    for (const auto& t : tests) {
-        auto results = eval_operators(t.operands, false);
-        if (std::find(results.begin(), results.end(), t.test_val) != results.end()) {
-            sum1 += t.test_val;
+    bool steal(size_t self) {
+        for (size_t k = 1; k < ranges_.size(); ++k) {
+            auto& victim = ranges_[(self + k) % ranges_.size()];
+            uint64_t r = victim.load();
+            while (lo(r) < hi(r)) {
+                uint32_t mid = hi(r) - (hi(r) - lo(r) + 1) / 2;
+                if (victim.compare_exchange_weak(r, pack(lo(r), mid))) {
+                    ranges_[self].store(pack(mid, hi(r)));
+                    return true;
+                }
+            }
         }
+        return false;
     }
-    std::cout << sum1 << std::endl;
 
-    uint64_t sum2 = 0;
-    for (const auto& t : tests) {
-        auto results = eval_operators(t.operands, true);
-        if (std::find(results.begin(), results.end(), t.test_val) != results.end()) {
-            sum2 += t.test_val;
+    std::vector<std::atomic<uint64_t>> ranges_;
+};
+
+// Both parts in one pass over the equations. Anything solvable with + and *
+// is also solvable once || is added, so part 2 only runs on part 1 misses.
+std::pair<uint64_t, uint64_t> solve_all(const Input& input, Solver solver, size_t threads) {
+    struct alignas(64) Sums {
+        uint64_t sum1 = 0, sum2 = 0;
+    };
+    std::vector<Sums> sums(threads);
+
+    StealPool pool(threads);
+    pool.run(static_cast<uint32_t>(input.tests.size()), [&](size_t w, uint32_t i) {
+        const auto& t = input.tests[i];
+        const uint64_t* operands = input.operands.data() + t.offset;
+        if (solver.part1(t.test_val, operands, t.len)) {
+            sums[w].sum1 += t.test_val;
+            sums[w].sum2 += t.test_val;
+        } else if (solver.part2(t.test_val, operands, t.len)) {
+            sums[w].sum2 += t.test_val;
+        }
+    });
+
+    uint64_t sum1 = 0, sum2 = 0;
+    for (const auto& s : sums) {
+        sum1 += s.sum1;
+        sum2 += s.sum2;
+    }
+    return {sum1, sum2};
+}
+
+// Time fn over every equation, reps times; returns the sum of solvable targets
+template <class F>
+uint64_t time_sum(const Input& input, const char* name, int reps, F fn) {
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < reps; ++k) {
+        sum = 0;
+        for (const auto& t : input.tests) {
+            if (fn(t.test_val, input.operands.data() + t.offset, t.len)) {
+                sum += t.test_val;
+            }
+        }
+    }
+    std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << sum << " in " << ms.count() / reps << "ms" << std::endl;
+    return sum;
+}
+
+// Specialized operator sets against the runtime use_concat evaluators
+void bench(const Input& input) {
+    Scratch scratch;
+    auto runtime_eval = [&](bool use_concat) {
+        return [&, use_concat](uint64_t target, const uint64_t* operands, size_t n) {
+            auto& results = eval_operators(operands, n, use_concat, scratch);
+            return std::find(results.begin(), results.end(), target) != results.end();
+        };
+    };
+    auto runtime_solve = [](bool use_concat) {
+        return [use_concat](uint64_t target, const uint64_t* operands, size_t n) {
+            return solvable(target, operands, n, use_concat);
+        };
+    };
+
+    bool same = true;
+    same &= time_sum(input, "enumerate runtime  {+,*}   ", 3, runtime_eval(false)) ==
+            time_sum(input, "enumerate template {+,*}   ", 3, enumerate_ops<Add, Mul>);
+    same &= time_sum(input, "enumerate runtime  {+,*,||}", 3, runtime_eval(true)) ==
+            time_sum(input, "enumerate template {+,*,||}", 3, enumerate_ops<Add, Mul, Concat>);
+    same &= time_sum(input, "backward runtime   {+,*}   ", 100, runtime_solve(false)) ==
+            time_sum(input, "backward template  {+,*}   ", 100, solve_ops<Mul, Add>);
+    same &= time_sum(input, "backward runtime   {+,*,||}", 100, runtime_solve(true)) ==
+            time_sum(input, "backward template  {+,*,||}", 100, solve_ops<Concat, Mul, Add>);
+    if (!same) {
+        std::cerr << "Specialized evaluator mismatch" << std::endl;
+        std::exit(1);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // --enumerate: build every result instead of solving backwards
+    Solver solver = BACKWARD;
+    bool run_bench = false;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+    bool usage = argc < 2;
+    for (int i = 2; i < argc && !usage; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--enumerate") {
+            solver = ENUMERATE;
+        } else if (arg == "--bench") {
+            run_bench = true;
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        } else {
+            usage = true;
         }
     }
+    if (usage) {
+        std::cerr << "Usage: " << argv[0] << " <input_file> [--enumerate] [--bench] [-j threads]" << std::endl;
+        return 1;
+    }
+
+    MappedFile file(argv[1]);
+    if (!file.is_open()) {
+        std::cerr << "Error reading file: " << argv[1] << std::endl;
+        return 1;
+    }
+    Input input = parse(file.begin(), file.end());
+
+    if (run_bench) {
+        bench(input);
+        return 0;
+    }
+
+    auto [sum1, sum2] = solve_all(input, solver, threads);
+    std::cout << sum1 << std::endl;
     std::cout << sum2 << std::endl;
 
     return 0;
@@ -1,151 +1,169 @@
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <vector>
-#include <queue>
-#include <cmath>
 #include <algorithm>
+#include <utility>
+#include <cstdint>
 
-// Memory Block Structure
-struct MemBlk {
-    size_t pos, len;
+#include "../common/mapped_file.h"
 
-    // Descending order by position
-    bool operator<(const MemBlk& other) const {
-        return pos > other.pos;
-    }
+// Memory Block Structure, packed to 12 bytes
+#pragma pack(push, 4)
+struct MemBlk {
+    uint64_t pos;
+    uint32_t len;
 };
+#pragma pack(pop)
+static_assert(sizeof(MemBlk) == 12, "MemBlk should be packed");
 
 // File Structure
 struct File {
-    size_t pos, size;
+    uint64_t pos;
+    uint32_t size;
     uint32_t id;
+};
 
-    // Ascending order by position
-    bool operator<(const File& other) const {
-        return pos < other.pos;
-    }
+// Disk map as files and gaps in position order; gaps[i] directly follows
+// files[i] and may be empty
+struct DiskMap {
+    std::vector<File> files;
+    std::vector<MemBlk> gaps;
 };
 
-// Parse input into file and memory block heaps
-std::pair<std::priority_queue<File>, std::priority_queue<MemBlk>> parse(const std::string& input) {
-    std::priority_queue<File> files;
-    std::priority_queue<MemBlk> memblks;
-    size_t pos = 0;
-    uint32_t file_id = 0;
+// Parse the digits of the disk map, stopping at the first non-digit
+DiskMap parse(const char* p, const char* end) {
+    DiskMap map;
+    size_t n = 0;
+    while (p + n < end && p[n] >= '0' && p[n] <= '9') ++n;
+
+    map.files.reserve((n + 1) / 2);
+    map.gaps.reserve((n + 1) / 2);
 
-    for (size_t i = 0; i < input.size(); i += 2) {
-        size_t file_size = input[i] - '0';
-        files.push({pos, file_size, file_id++});
+    uint64_t pos = 0;
+    uint32_t file_id = 0;
+    for (size_t i = 0; i < n; i += 2) {
+        uint32_t file_size = p[i] - '0';
+        map.files.push_back({pos, file_size, file_id++});
         pos += file_size;
 
-        if (i + 1 < input.size()) {
-            size_t freesize = input[i + 1] - '0';
-            if (freesize > 0) {
-                memblks.push({pos, freesize});
-                pos += freesize;
-            }
-        }
+        uint32_t freesize = i + 1 < n ? p[i + 1] - '0' : 0;
+        map.gaps.push_back({pos, freesize});
+        pos += freesize;
     }
 
-    return {files, memblks};
+    return map;
+}
+
+// Checksum of one extent: id * (pos + ... + pos + size - 1)
+uint64_t checksum(uint64_t pos, uint64_t size, uint32_t id) {
+    return id * (size * pos + size * (size - 1) / 2);
 }
 
-// Compute checksum
-uint64_t checksum(const std::vector<File>& files) {
+// Part 1: Greedy allocation. Walks the disk map from the left while the
+// rightmost unmoved file fills each gap, adding one extent per fill.
+uint64_t part1(const DiskMap& map) {
+    const auto& files = map.files;
+    const auto& gaps = map.gaps;
+    if (files.empty()) return 0;
+
+    // Rightmost unmoved file and how many of its blocks are left
+    size_t last = files.size() - 1;
+    uint64_t left = files[last].size;
+    uint64_t pos = 0;
     uint64_t sum = 0;
-    for (const auto& file : files) {
-        for (size_t pos = file.pos; pos < file.pos + file.size; ++pos) {
-            sum += pos * file.id;
+
+    for (size_t i = 0; i <= last; ++i) {
+        uint64_t size = i == last ? left : files[i].size;
+        sum += checksum(pos, size, files[i].id);
+        pos += size;
+
+        uint64_t gap = gaps[i].len;
+        while (gap > 0 && last > i) {
+            uint64_t take = std::min(gap, left);
+            sum += checksum(pos, take, files[last].id);
+            pos += take;
+            gap -= take;
+            left -= take;
+            if (left == 0) {
+                --last;
+                left = files[last].size;
+            }
         }
     }
+
     return sum;
 }
 
-// Part 1: Greedy allocation
-uint64_t part1(const std::string& input) {
-    auto [files, memblks] = parse(input);
-    std::vector<File> final_files;
-
-    while (!files.empty()) {
-        auto file = files.top();
-        files.pop();
-
-        if (!memblks.empty()) {
-            auto memblk = memblks.top();
-            memblks.pop();
-
-            if (memblk.pos >= file.pos) {
-                final_files.push_back(file);
-                memblks.push(memblk);
-                continue;
-            }
+// Max segment tree over gap lengths, gaps in position order. Finds the
+// leftmost gap that fits a file in O(log gaps), whatever the gap sizes.
+class GapIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit GapIndex(std::vector<MemBlk> gaps) : gaps_(std::move(gaps)) {
+        size_ = 1;
+        while (size_ < gaps_.size()) size_ *= 2;
+        tree_.assign(2 * size_, 0);
+        for (size_t i = 0; i < gaps_.size(); ++i) {
+            tree_[size_ + i] = gaps_[i].len;
+        }
+        for (size_t i = size_ - 1; i > 0; --i) {
+            tree_[i] = std::max(tree_[2 * i], tree_[2 * i + 1]);
+        }
+    }
 
-            if (file.size <= memblk.len) {
-                final_files.push_back({memblk.pos, file.size, file.id});
-                if (memblk.len > file.size) {
-                    memblks.push({memblk.pos + file.size, memblk.len - file.size});
-                }
-            } else {
-                final_files.push_back({memblk.pos, memblk.len, file.id});
-                files.push({file.pos, file.size - memblk.len, file.id});
-            }
+    // Index of the leftmost gap with at least len blocks, or npos
+    size_t find(uint32_t len) const {
+        if (gaps_.empty() || tree_[1] < len) return npos;
+        size_t i = 1;
+        while (i < size_) {
+            i = tree_[2 * i] >= len ? 2 * i : 2 * i + 1;
         }
+        return i - size_;
     }
 
-    return checksum(final_files);
-}
+    const MemBlk& gap(size_t i) const {
+        return gaps_[i];
+    }
 
-// Part 2: Alternative allocation
-uint64_t part2(const std::string& input) {
-    auto [files, memblks] = parse(input);
-    std::vector<File> final_files;
-
-    while (!files.empty()) {
-        auto file = files.top();
-        files.pop();
-
-        std::priority_queue<MemBlk> new_blks;
-
-        while (!memblks.empty()) {
-            auto memblk = memblks.top();
-            memblks.pop();
-
-            if (memblk.pos >= file.pos) {
-                final_files.push_back(file);
-                new_blks.push(memblk);
-                while (!new_blks.empty()) {
-                    memblks.push(new_blks.top());
-                    new_blks.pop();
-                }
-                goto next_file;
-            }
+    // Fill the first `used` blocks of gap i
+    void take(size_t i, uint32_t used) {
+        gaps_[i].pos += used;
+        gaps_[i].len -= used;
+        size_t node = size_ + i;
+        tree_[node] = gaps_[i].len;
+        for (node /= 2; node > 0; node /= 2) {
+            tree_[node] = std::max(tree_[2 * node], tree_[2 * node + 1]);
+        }
+    }
 
-            if (file.size <= memblk.len) {
-                final_files.push_back({memblk.pos, file.size, file.id});
-                if (memblk.len > file.size) {
-                    new_blks.push({memblk.pos + file.size, memblk.len - file.size});
-                }
-                while (!new_blks.empty()) {
-                    memblks.push(new_blks.top());
-                    new_blks.pop();
-                }
-                goto next_file;
-            }
+private:
+    std::vector<MemBlk> gaps_;
+    std::vector<uint32_t> tree_;
+    size_t size_;
+};
 
-            new_blks.push(memblk);
-        }
+// Part 2: Alternative allocation. Takes the map so its gaps move into the
+// index instead of being copied.
+uint64_t part2(DiskMap map) {
+    GapIndex index(std::move(map.gaps));
+    uint64_t sum = 0;
 
-        final_files.push_back(file);
-        while (!new_blks.empty()) {
-            memblks.push(new_blks.top());
-            new_blks.pop();
+    // Files from right to left, each moved at most once
+    for (size_t k = map.files.size(); k-- > 0;) {
+        const auto& file = map.files[k];
+
+        // Move to the leftmost gap that fits, if it is before the file
+        size_t i = index.find(file.size);
+        if (i != GapIndex::npos && index.gap(i).pos < file.pos) {
+            sum += checksum(index.gap(i).pos, file.size, file.id);
+            index.take(i, file.size);
+        } else {
+            sum += checksum(file.pos, file.size, file.id);
         }
-
-    next_file:;
     }
 
-    return checksum(final_files);
+    return sum;
 }
 
 // Main Function
@@ -155,17 +173,16 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    std::ifstream file(argv[1]);
+    MappedFile file(argv[1]);
     if (!file.is_open()) {
         std::cerr << "Error: Could not open file." << std::endl;
         return 1;
     }
 
-    std::string input;
-    file >> input;
+    DiskMap map = parse(file.begin(), file.end());
 
-    std::cout << part1(input) << std::endl;
-    std::cout << part2(input) << std::endl;
+    std::cout << part1(map) << std::endl;
+    std::cout << part2(std::move(map)) << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -2,104 +2,165 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
-#include <queue>
-#include <unordered_map>
-#include <unordered_set>
-#include <utility>
-
-using Pos = std::pair<int, int>;
-using Path = std::vector<Pos>;
-
-struct PosHash {
-    std::size_t operator()(const Pos& pos) const {
-        return std::hash<int>()(pos.first) ^ (std::hash<int>()(pos.second) << 1);
+#include <array>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+#include <chrono>
+
+#include "../common/dense_grid.h"
+
+// Heights; cells outside the map or not a digit never have a neighbor
+constexpr int8_t NO_HEIGHT = INT8_MAX;
+using Map = DenseGrid<int8_t>;
+// Horizontal tiles of the map, one per worker; tile t covers rows
+// [begin(t), begin(t + 1))
+struct Tiles {
+    int count, height;
+    std::vector<int> of_row;
+
+    Tiles(int count, int height) : count(std::max(1, std::min(count, height))), height(height), of_row(height) {
+        for (int t = 0; t < this->count; ++t) {
+            for (int y = begin(t); y < begin(t + 1); ++y) of_row[y] = t;
+        }
     }
-};
 
-struct PathHash {
-    std::size_t operator()(const std::pair<Path, Pos>& entry) const {
-        std::size_t hash = 0;
-        for (const auto& p : entry.first) {
-            hash ^= std::hash<int>()(p.first) ^ (std::hash<int>()(p.second) << 1);
+    int begin(int t) const { return static_cast<int>(static_cast<int64_t>(height) * t / count); }
+
+    // Run f(t, row_begin, row_end) for every tile, one thread each
+    template <class F>
+    void run(F f) const {
+        std::vector<std::thread> threads;
+        for (int t = 1; t < count; ++t) {
+            threads.emplace_back([&, t] { f(t, begin(t), begin(t + 1)); });
         }
-        hash ^= std::hash<int>()(entry.second.first) ^ (std::hash<int>()(entry.second.second) << 1);
-        return hash;
+        f(0, begin(0), begin(1));
+        for (auto& th : threads) th.join();
     }
 };
 
-using Map = std::unordered_map<Pos, int, PosHash>;
-
-// Helper to find neighbors
-std::vector<Pos> neighbors(const Pos& pos, const Map& map) {
-    static const std::vector<std::pair<int, int>> directions = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
-    std::vector<Pos> result;
-
-    int curr_height = map.at(pos);
-    for (const auto& [dy, dx] : directions) {
-        Pos new_pos = {pos.first + dy, pos.second + dx};
-        if (map.find(new_pos) != map.end() && map.at(new_pos) - curr_height == 1) {
-            result.push_back(new_pos);
-        }
+// Score of every trailhead at once: sweep heights 9 down to 0, where each
+// cell carries the sorted ids of the 9-cells it reaches, merged from its
+// one-higher neighbors. Only the sets of two layers are held at a time.
+// Each layer is split into tiles with their own pools and scratch.
+uint64_t score_all(const Map& map, int threads) {
+    Tiles tiles(threads, map.height);
+
+    // Set of cell i is [offset[i], offset[i] + length[i]) of the pool of the
+    // tile owning its row, in its layer
+    std::vector<uint32_t> offset(map.cells.size()), length(map.cells.size());
+    std::vector<std::vector<uint32_t>> higher(tiles.count), pool(tiles.count), merged(tiles.count), spare(tiles.count);
+    std::vector<uint64_t> totals(tiles.count, 0);
+    auto dirs = map.directions();
+
+    for (int h = 9; h >= 0; --h) {
+        tiles.run([&](int t, int y0, int y1) {
+            auto& out = pool[t];
+            auto& set = merged[t];
+            auto& tmp = spare[t];
+            out.clear();
+            for (int y = y0; y < y1; ++y) {
+                for (size_t i = map.index(y, 0), end = i + map.width; i < end; ++i) {
+                    if (map[i] != h) continue;
+
+                    set.clear();
+                    if (h == 9) {
+                        set.push_back(static_cast<uint32_t>(i));
+                    }
+                    for (auto d : dirs) {
+                        size_t n = i + d;
+                        if (h == 9 || map[n] != h + 1) continue;
+                        const auto& src = higher[tiles.of_row[n / map.stride - 1]];
+                        auto first = src.begin() + offset[n];
+                        tmp.resize(set.size() + length[n]);
+                        std::merge(set.begin(), set.end(), first, first + length[n], tmp.begin());
+                        std::swap(set, tmp);
+                    }
+                    set.erase(std::unique(set.begin(), set.end()), set.end());
+
+                    offset[i] = static_cast<uint32_t>(out.size());
+                    length[i] = static_cast<uint32_t>(set.size());
+                    out.insert(out.end(), set.begin(), set.end());
+                    if (h == 0) totals[t] += set.size();
+                }
+            }
+        });
+        std::swap(higher, pool);
     }
-    return result;
+    return std::accumulate(totals.begin(), totals.end(), uint64_t(0));
 }
 
-// Count paths to positions with height 9
-int count_paths(const Pos& from, const Map& map) {
-    std::queue<Pos> queue;
-    std::unordered_set<Pos, PosHash> visited;
-    queue.push(from);
-
-    int sum = 0;
-    while (!queue.empty()) {
-        Pos current = queue.front();
-        queue.pop();
-
-        if (visited.count(current)) continue;
-        visited.insert(current);
-
-        if (map.at(current) == 9) {
-            ++sum;
-        }
-
-        for (const auto& neighbor : neighbors(current, map)) {
-            queue.push(neighbor);
-        }
+// Rating of every trailhead at once: sweep heights 9 down to 0, where each
+// cell's trail count is the sum over its one-higher neighbors
+uint64_t rate_all(const Map& map, int threads) {
+    Tiles tiles(threads, map.height);
+    std::vector<uint64_t> trails(map.cells.size(), 0);
+    std::vector<uint64_t> totals(tiles.count, 0);
+    auto dirs = map.directions();
+
+    for (int h = 9; h >= 0; --h) {
+        tiles.run([&](int t, int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                for (size_t i = map.index(y, 0), end = i + map.width; i < end; ++i) {
+                    if (map[i] != h) continue;
+                    if (h == 9) {
+                        trails[i] = 1;
+                        continue;
+                    }
+                    uint64_t sum = 0;
+                    for (auto d : dirs) {
+                        if (map[i + d] == h + 1) sum += trails[i + d];
+                    }
+                    trails[i] = sum;
+                    if (h == 0) totals[t] += sum;
+                }
+            }
+        });
     }
-    return sum;
+    return std::accumulate(totals.begin(), totals.end(), uint64_t(0));
 }
 
-// Count paths and track full paths
-int count_paths2(const Pos& from, const Map& map) {
-    std::queue<std::pair<Path, Pos>> queue;
-    std::unordered_set<std::pair<Path, Pos>, PathHash> visited;
-
-    queue.push({{from}, from});
-    int sum = 0;
-
-    while (!queue.empty()) {
-        auto [path, current] = queue.front();
-        queue.pop();
-
-        if (visited.count({path, current})) continue;
-        visited.insert({path, current});
-
-        if (map.at(current) == 9) {
-            ++sum;
-        }
-
-        for (const auto& neighbor : neighbors(current, map)) {
-            Path new_path = path;
-            new_path.push_back(current);
-            queue.push({new_path, neighbor});
+// Time both engines from 1 to max_threads workers
+void bench(const Map& map, int max_threads) {
+    uint64_t score = 0, rating = 0;
+    for (int threads = 1; threads <= max_threads; ++threads) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t s = score_all(map, threads);
+        auto mid = std::chrono::steady_clock::now();
+        uint64_t r = rate_all(map, threads);
+        auto end = std::chrono::steady_clock::now();
+
+        if (threads == 1) {
+            score = s;
+            rating = r;
+        } else if (s != score || r != rating) {
+            std::cerr << "Result mismatch with " << threads << " threads" << std::endl;
+            std::exit(1);
         }
+        std::chrono::duration<double, std::milli> score_ms = mid - start, rate_ms = end - mid;
+        std::cout << threads << " threads: score " << score_ms.count() << "ms, rating " << rate_ms.count() << "ms" << std::endl;
     }
-    return sum;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <input_file>" << std::endl;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool run_bench = false;
+
+    bool usage = argc < 2;
+    for (int i = 2; i < argc && !usage; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bench") {
+            run_bench = true;
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        } else {
+            usage = true;
+        }
+    }
+    if (usage) {
+        std::cerr << "Usage: " << argv[0] << " <input_file> [--bench] [-j threads]" << std::endl;
         return 1;
     }
 
@@ -109,36 +170,33 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    Map map;
+    std::vector<std::string> lines;
     std::string line;
-    int y = 0;
-
+    size_t width = 0;
     while (std::getline(file, line)) {
-        for (int x = 0; x < line.size(); ++x) {
-            char c = line[x];
-            int height = (c >= '0' && c <= '9') ? c - '0' : 1000;
-            map[{y, x}] = height;
-        }
-        ++y;
+        width = std::max(width, line.size());
+        lines.push_back(line);
     }
 
-    // Find all positions with height 0
-    std::vector<Pos> zeros;
-    for (const auto& [pos, height] : map) {
-        if (height == 0) {
-            zeros.push_back(pos);
+    Map map(static_cast<int>(lines.size()), static_cast<int>(width), NO_HEIGHT);
+    for (int y = 0; y < map.height; ++y) {
+        for (int x = 0; x < static_cast<int>(lines[y].size()); ++x) {
+            char c = lines[y][x];
+            map[map.index(y, x)] = (c >= '0' && c <= '9') ? c - '0' : NO_HEIGHT;
         }
     }
 
-    // Calculate path sums
-    int sum1 = 0, sum2 = 0;
-    for (const auto& zero : zeros) {
-        sum1 += count_paths(zero, map);
-        sum2 += count_paths2(zero, map);
+    if (run_bench) {
+        bench(map, threads);
+        return 0;
     }
 
+    // Calculate path sums
+    uint64_t sum1 = score_all(map, threads);
+    uint64_t sum2 = rate_all(map, threads);
+
     std::cout << sum1 << std::endl;
     std::cout << sum2 << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -5,10 +5,20 @@
 #include <unordered_map>
 #include <string>
 #include <numeric>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <memory>
+#include <thread>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-// Type alias for cache
-using Cache = std::unordered_map<std::pair<int64_t, int64_t>, size_t, 
-    std::function<size_t(const std::pair<int64_t, int64_t>&)>>;
+#include "../common/digits.h"
 
 // Custom hash function for pair
 struct PairHash {
@@ -17,38 +27,171 @@ struct PairHash {
     }
 };
 
+// Type alias for cache
+using Cache = std::unordered_map<std::pair<int64_t, int64_t>, size_t, PairHash>;
+
+// Split a stone with an even number of digits d into stone / 10^(d/2) and
+// stone % 10^(d/2)
+bool split(int64_t stone, int64_t& left, int64_t& right) {
+    uint32_t d = digits(stone);
+    if (d % 2 != 0) {
+        return false;
+    }
+    int64_t p = POW10[d / 2];
+    left = stone / p;
+    right = stone % p;
+    return true;
+}
+
+// Marks a missing second child in blink_stone
+constexpr int64_t NO_STONE = -1;
+
+// What a stone turns into after one blink; out[1] is NO_STONE unless it splits
+void blink_stone(int64_t stone, int64_t out[2]) {
+    out[1] = NO_STONE;
+    if (stone == 0) {
+        out[0] = 1;
+    } else if (!split(stone, out[0], out[1])) {
+        out[0] = stone * 2024;
+    }
+}
+
+// Precomputed stone table file, little-endian:
+//   header: magic "AOC11TBL", u32 version, u32 max_blinks, u64 num_values,
+//           u64 FNV-1a checksum of the header fields before it and of
+//           everything after the header
+//   int64_t values[num_values], strictly ascending
+//   uint64_t counts[num_values][max_blinks + 1], stones after t blinks
+struct TableHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t max_blinks;
+    uint64_t num_values;
+    uint64_t checksum;
+};
+
+constexpr char TABLE_MAGIC[8] = {'A', 'O', 'C', '1', '1', 'T', 'B', 'L'};
+constexpr uint32_t TABLE_VERSION = 2;
+
+uint64_t fnv1a(const char* p, size_t n, uint64_t h = 0xcbf29ce484222325ULL) {
+    for (size_t i = 0; i < n; ++i) {
+        h = (h ^ static_cast<unsigned char>(p[i])) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Checksum of the header fields before `checksum`, then of the body
+uint64_t table_checksum(const TableHeader& header, const char* body, size_t n) {
+    uint64_t h = fnv1a(reinterpret_cast<const char*>(&header), offsetof(TableHeader, checksum));
+    return fnv1a(body, n, h);
+}
+
+// Read-only view of a table file, memory-mapped at startup
+class StoneTable {
+public:
+    // Map and validate the file; error() says why it is unusable
+    explicit StoneTable(const char* path) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            error_ = "cannot open";
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_ = static_cast<size_t>(st.st_size);
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) data_ = static_cast<const char*>(p);
+        }
+        close(fd);
+        error_ = validate();
+    }
+    ~StoneTable() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+    }
+    StoneTable(const StoneTable&) = delete;
+    StoneTable& operator=(const StoneTable&) = delete;
+
+    const char* error() const { return error_; }
+
+    // Stones `stone` becomes after `times` blinks, if the table has it
+    bool lookup(int64_t stone, int64_t times, size_t& count) const {
+        if (error_ || times < 0 || times > header_.max_blinks) return false;
+        auto end = values_ + header_.num_values;
+        auto it = std::lower_bound(values_, end, stone);
+        if (it == end || *it != stone) return false;
+        count = counts_[(it - values_) * (uint64_t(header_.max_blinks) + 1) + times];
+        return true;
+    }
+
+private:
+    const char* validate() {
+        if (!data_ || size_ < sizeof(TableHeader)) return "truncated";
+        std::memcpy(&header_, data_, sizeof(header_));
+        if (std::memcmp(header_.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0) return "not a stone table";
+        if (header_.version != TABLE_VERSION) return "unsupported version";
+
+        // 64-bit sizes: max_blinks + 1 overflows 32 bits, and num_values is untrusted
+        uint64_t row = (uint64_t(header_.max_blinks) + 1) * sizeof(uint64_t) + sizeof(int64_t);
+        uint64_t available = size_ - sizeof(TableHeader);
+        if (header_.num_values > available / row || header_.num_values * row != available) return "size mismatch";
+        const char* body = data_ + sizeof(TableHeader);
+        if (table_checksum(header_, body, available) != header_.checksum) return "checksum mismatch";
+
+        auto values = reinterpret_cast<const int64_t*>(body);
+        for (uint64_t i = 1; i < header_.num_values; ++i) {
+            if (values[i - 1] >= values[i]) return "values not sorted";
+        }
+        values_ = values;
+        counts_ = reinterpret_cast<const uint64_t*>(values_ + header_.num_values);
+        return nullptr;
+    }
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const char* error_ = nullptr;
+    TableHeader header_{};
+    const int64_t* values_ = nullptr;
+    const uint64_t* counts_ = nullptr;
+};
+
+// Table given with --table, consulted by count_len before computing
+const StoneTable* stone_table = nullptr;
+
 // Recursive function to count lengths
 size_t count_len(int64_t stone, int64_t times, Cache& cache) {
     if (times == 0) {
         return 1;
     }
 
+    size_t count;
+    if (stone_table && stone_table->lookup(stone, times, count)) {
+        return count;
+    }
+
     auto key = std::make_pair(stone, times);
-    if (cache.find(key) != cache.end()) {
-        return cache[key];
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
     }
 
     size_t result = 0;
-    std::string stone_str = std::to_string(stone);
+    int64_t left, right;
     if (stone == 0) {
         result = count_len(1, times - 1, cache);
-    } else if (stone_str.length() % 2 == 0) {
-        // Split the string into two halves and convert to integers
-        std::string left = stone_str.substr(0, stone_str.size() / 2);
-        std::string right = stone_str.substr(stone_str.size() / 2);
-        result = count_len(std::stoll(left), times - 1, cache) +
-                 count_len(std::stoll(right), times - 1, cache);
+    } else if (split(stone, left, right)) {
+        result = count_len(left, times - 1, cache) +
+                 count_len(right, times - 1, cache);
     } else {
         result = count_len(stone * 2024, times - 1, cache);
     }
 
-    cache[key] = result;
+    cache.emplace(key, result);
     return result;
 }
 
 // Run function
 size_t run(const std::vector<int64_t>& stones, int64_t times) {
-    Cache cache(0, PairHash());
+    Cache cache;
     size_t total = 0;
 
     for (const auto& stone : stones) {
@@ -58,29 +201,622 @@ size_t run(const std::vector<int64_t>& stones, int64_t times) {
     return total;
 }
 
+// 64-bit finalizer (MurmurHash3 fmix64 style)
+inline uint64_t mix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    return k;
+}
+
+// Open-addressing stone -> count table with linear probing
+class FlatMap {
+public:
+    explicit FlatMap(size_t capacity = 64) {
+        size_t n = 16;
+        while (n < capacity * 2) n *= 2;
+        keys_.assign(n, EMPTY);
+        counts_.assign(n, 0);
+    }
+
+    void add(int64_t stone, size_t count) {
+        auto key = static_cast<uint64_t>(stone);
+        size_t mask = keys_.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (keys_[i] == key) {
+                counts_[i] += count;
+                return;
+            }
+            if (keys_[i] == EMPTY) {
+                keys_[i] = key;
+                counts_[i] = count;
+                if (++size_ * 2 > keys_.size()) grow();
+                return;
+            }
+        }
+    }
+
+    // Empty the table, keeping its capacity
+    void clear() {
+        std::fill(keys_.begin(), keys_.end(), EMPTY);
+        size_ = 0;
+    }
+
+    template <class F>
+    void for_each(F f) const {
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            if (keys_[i] != EMPTY) f(static_cast<int64_t>(keys_[i]), counts_[i]);
+        }
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    static constexpr uint64_t EMPTY = ~uint64_t(0);
+
+    void grow() {
+        FlatMap bigger(keys_.size());
+        for_each([&](int64_t stone, size_t count) { bigger.add(stone, count); });
+        *this = std::move(bigger);
+    }
+
+    std::vector<uint64_t> keys_;
+    std::vector<size_t> counts_;
+    size_t size_ = 0;
+};
+
+// Iterative engine: advance a stone -> count table one blink at a time
+size_t blink(const std::vector<int64_t>& stones, int64_t times) {
+    FlatMap cur(stones.size()), next;
+    for (const auto& stone : stones) {
+        cur.add(stone, 1);
+    }
+
+    for (int64_t t = 0; t < times; ++t) {
+        next.clear();
+        cur.for_each([&](int64_t stone, size_t count) {
+            int64_t children[2];
+            blink_stone(stone, children);
+            next.add(children[0], count);
+            if (children[1] != NO_STONE) {
+                next.add(children[1], count);
+            }
+        });
+        std::swap(cur, next);
+    }
+
+    size_t total = 0;
+    cur.for_each([&](int64_t, size_t count) { total += count; });
+    return total;
+}
+
+// Run f(0..workers-1), one thread each
+template <class F>
+void run_workers(int workers, F f) {
+    std::vector<std::thread> threads;
+    for (int w = 1; w < workers; ++w) {
+        threads.emplace_back(f, w);
+    }
+    f(0);
+    for (auto& t : threads) t.join();
+}
+
+// Parallel engine: the stone -> count table is split into one FlatMap shard
+// per thread, by the high bits of the hash (the shards probe with the low
+// bits). Each blink, every thread expands its own shard into batches for
+// each destination shard, then merges the batches addressed to it.
+size_t blink_sharded(const std::vector<int64_t>& stones, int64_t times, int threads) {
+    using Batch = std::vector<std::pair<int64_t, size_t>>;
+    const size_t shards = static_cast<size_t>(threads);
+    auto shard_of = [&](int64_t stone) { return (mix(stone) >> 32) % shards; };
+
+    std::vector<FlatMap> table(shards);
+    // outbox[from][to]: children produced by shard `from` owned by shard `to`
+    std::vector<std::vector<Batch>> outbox(shards, std::vector<Batch>(shards));
+
+    auto merge = [&](int w) {
+        auto& shard = table[w];
+        shard.clear();
+        for (size_t from = 0; from < shards; ++from) {
+            for (const auto& [stone, count] : outbox[from][w]) shard.add(stone, count);
+        }
+    };
+
+    // Initial stones, split evenly over the threads
+    run_workers(threads, [&](int w) {
+        size_t begin = stones.size() * w / shards, end = stones.size() * (w + 1) / shards;
+        for (size_t i = begin; i < end; ++i) {
+            outbox[w][shard_of(stones[i])].push_back({stones[i], 1});
+        }
+    });
+    run_workers(threads, merge);
+
+    for (int64_t t = 0; t < times; ++t) {
+        run_workers(threads, [&](int w) {
+            for (auto& batch : outbox[w]) batch.clear();
+            table[w].for_each([&](int64_t stone, size_t count) {
+                int64_t children[2];
+                blink_stone(stone, children);
+                for (auto child : children) {
+                    if (child != NO_STONE) outbox[w][shard_of(child)].push_back({child, count});
+                }
+            });
+        });
+        run_workers(threads, merge);
+    }
+
+    size_t total = 0;
+    for (const auto& shard : table) {
+        shard.for_each([&](int64_t, size_t count) { total += count; });
+    }
+    return total;
+}
+
+// Every stone value reachable from the stones added so far, by index. The
+// set is finite (even-digit values keep splitting back down), so a blink is
+// a fixed sparse linear map over it.
+struct Closure {
+    static constexpr uint32_t NONE = ~uint32_t(0);
+
+    std::vector<int64_t> values;
+    // Indices of what values[i] turns into; the second is NONE unless it splits
+    std::vector<std::array<uint32_t, 2>> children;
+    std::unordered_map<int64_t, uint32_t> index;
+
+    // Index of value, adding it and everything it can become if it is new
+    uint32_t add(int64_t value) {
+        uint32_t i = intern(value);
+        // values grows while we walk it; each new value is expanded once
+        for (size_t k = children.size(); k < values.size(); ++k) {
+            int64_t next[2];
+            blink_stone(values[k], next);
+            uint32_t first = intern(next[0]);
+            uint32_t second = next[1] == NO_STONE ? NONE : intern(next[1]);
+            children.push_back({first, second});
+        }
+        return i;
+    }
+
+private:
+    uint32_t intern(int64_t value) {
+        auto [it, added] = index.emplace(value, static_cast<uint32_t>(values.size()));
+        if (added) values.push_back(value);
+        return it->second;
+    }
+};
+
+// Count arithmetic policies for the closure engines
+struct ModRing {
+    using Count = uint64_t;
+    uint64_t p;
+
+    Count add(Count a, Count b) const { return (a + b) % p; }
+    Count mul(Count a, Count b) const { return static_cast<Count>(static_cast<unsigned __int128>(a) * b % p); }
+    Count from(uint64_t a) const { return a % p; }
+};
+
+// One blink of the per-value counts over the closure
+template <class Ring>
+void step(const Closure& c, const Ring& ring, const std::vector<typename Ring::Count>& cur,
+          std::vector<typename Ring::Count>& next) {
+    next.assign(cur.size(), 0);
+    for (size_t i = 0; i < cur.size(); ++i) {
+        if (cur[i] == 0) continue;
+        auto [first, second] = c.children[i];
+        next[first] = ring.add(next[first], cur[i]);
+        if (second != Closure::NONE) next[second] = ring.add(next[second], cur[i]);
+    }
+}
+
+// Total stones after 0, 1, ..., n - 1 blinks, starting from start[i] stones
+// of each value
+template <class Ring>
+std::vector<typename Ring::Count> totals(const Closure& c, const Ring& ring, const std::vector<uint64_t>& start, size_t n) {
+    using Count = typename Ring::Count;
+    std::vector<Count> cur(c.values.size()), next, result;
+    for (size_t i = 0; i < cur.size(); ++i) cur[i] = ring.from(start[i]);
+
+    for (size_t t = 0; t < n; ++t) {
+        Count total = 0;
+        for (auto count : cur) total = ring.add(total, count);
+        result.push_back(total);
+        step(c, ring, cur, next);
+        std::swap(cur, next);
+    }
+    return result;
+}
+
+uint64_t pow_mod(uint64_t a, uint64_t e, const ModRing& ring) {
+    uint64_t r = ring.from(1);
+    for (a = ring.from(a); e > 0; e >>= 1, a = ring.mul(a, a)) {
+        if (e & 1) r = ring.mul(r, a);
+    }
+    return r;
+}
+
+// Deterministic Miller-Rabin for 64-bit n
+bool is_prime(uint64_t n) {
+    if (n < 2) return false;
+    for (uint64_t q : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        if (n % q == 0) return n == q;
+    }
+    ModRing ring{n};
+    uint64_t d = n - 1;
+    int r = 0;
+    for (; d % 2 == 0; d /= 2) ++r;
+    for (uint64_t a : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        uint64_t x = pow_mod(a, d, ring);
+        if (x == 1 || x == n - 1) continue;
+        bool composite = true;
+        for (int i = 1; i < r && composite; ++i) {
+            x = ring.mul(x, x);
+            composite = x != n - 1;
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+// Shortest recurrence a[n] = sum rec[j] * a[n - 1 - j] (Berlekamp-Massey, mod a prime)
+std::vector<uint64_t> recurrence(const std::vector<uint64_t>& a, const ModRing& ring) {
+    uint64_t p = ring.p;
+    std::vector<uint64_t> cur, prev;
+    size_t fail = 0;
+    uint64_t fail_delta = 0;
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        uint64_t delta = a[i];
+        for (size_t j = 0; j < cur.size(); ++j) {
+            delta = ring.add(delta, p - ring.mul(cur[j], a[i - 1 - j]));
+        }
+        if (delta == 0) continue;
+
+        if (fail_delta == 0) {
+            cur.assign(i + 1, 0);
+            fail = i;
+            fail_delta = delta;
+            continue;
+        }
+
+        // cur -= (delta / fail_delta) * x^(i - fail - 1) * (1 - prev)
+        uint64_t k = ring.mul(delta, pow_mod(fail_delta, p - 2, ring));
+        std::vector<uint64_t> next(i - fail - 1, 0);
+        next.push_back(k);
+        for (auto x : prev) next.push_back(ring.mul(p - x, k));
+        if (next.size() < cur.size()) next.resize(cur.size(), 0);
+        for (size_t j = 0; j < cur.size(); ++j) next[j] = ring.add(next[j], cur[j]);
+
+        if (i - fail + prev.size() >= cur.size()) {
+            prev = cur;
+            fail = i;
+            fail_delta = delta;
+        }
+        cur = std::move(next);
+    }
+    return cur;
+}
+
+// a[times] for a sequence with a[n] = sum rec[j] * a[n - 1 - j], from its
+// first rec.size() terms: x^times is reduced modulo the recurrence by
+// repeated squaring
+uint64_t nth_term(const std::vector<uint64_t>& rec, const std::vector<uint64_t>& a, uint64_t times, const ModRing& ring) {
+    size_t n = rec.size();
+    if (n == 0) return 0;
+
+    // a*b mod (x^n - rec[0] x^(n-1) - ... - rec[n-1])
+    auto mul_mod = [&](const std::vector<uint64_t>& x, const std::vector<uint64_t>& y) {
+        std::vector<uint64_t> z(2 * n - 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            if (x[i] == 0) continue;
+            for (size_t j = 0; j < n; ++j) z[i + j] = ring.add(z[i + j], ring.mul(x[i], y[j]));
+        }
+        for (size_t k = 2 * n - 2; k >= n; --k) {
+            if (z[k] == 0) continue;
+            for (size_t j = 0; j < n; ++j) z[k - 1 - j] = ring.add(z[k - 1 - j], ring.mul(z[k], rec[j]));
+        }
+        z.resize(n);
+        return z;
+    };
+
+    std::vector<uint64_t> result(n, 0), base(n, 0);
+    result[0] = 1;
+    if (n == 1) base[0] = rec[0]; else base[1] = 1;
+    for (uint64_t e = times; e > 0; e >>= 1, base = mul_mod(base, base)) {
+        if (e & 1) result = mul_mod(result, base);
+    }
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; ++i) total = ring.add(total, ring.mul(result[i], a[i]));
+    return total;
+}
+
+// Stones after any number of blinks modulo the prime p, batch after batch.
+// One closure is shared and grown by every batch. A batch's totals satisfy a
+// linear recurrence no longer than the closure, found once from its first
+// terms when the batch is added; every horizon is then answered from it.
+class ModBlinkCache {
+public:
+    explicit ModBlinkCache(uint64_t p) : ring_{p} {}
+
+    // Add a batch of stones; returns its id
+    size_t add(const std::vector<int64_t>& stones) {
+        std::vector<uint32_t> roots;
+        for (const auto& stone : stones) {
+            roots.push_back(closure_.add(stone));
+        }
+        std::vector<uint64_t> start(closure_.values.size(), 0);
+        for (auto i : roots) {
+            start[i]++;
+        }
+
+        Batch batch;
+        batch.terms = totals(closure_, ring_, start, 2 * closure_.values.size() + 2);
+        batch.rec = recurrence(batch.terms, ring_);
+        batches_.push_back(std::move(batch));
+        return batches_.size() - 1;
+    }
+
+    // Stones of batch `id` after `times` blinks, modulo p
+    uint64_t total(size_t id, uint64_t times) const {
+        const auto& batch = batches_[id];
+        if (times < batch.terms.size()) return batch.terms[times];
+        return nth_term(batch.rec, batch.terms, times, ring_);
+    }
+
+private:
+    struct Batch {
+        std::vector<uint64_t> terms, rec;
+    };
+
+    ModRing ring_;
+    Closure closure_;
+    std::vector<Batch> batches_;
+};
+
+// Even a single stone passes 2^128 stones within about 216 blinks, so exact
+// counts stop here; longer horizons are only served modulo a prime (--mod)
+constexpr uint64_t MAX_EXACT_BLINKS = 256;
+
+// Warm table shared by every horizon and stone batch queried against it:
+// rows_[t][i] is how many stones values[i] becomes after t blinks, as 128-bit
+// counts that saturate at OVERFLOW. New batches extend the closure and fill
+// in only the new columns; longer horizons append rows. Horizons stop at
+// MAX_EXACT_BLINKS, which keeps the table small.
+class BlinkCache {
+public:
+    using Count = unsigned __int128;
+    // Any count of 2^128 - 1 or more
+    static constexpr Count OVERFLOW = ~Count(0);
+
+    // Total stones of the batch after each of the horizons
+    std::vector<Count> query(const std::vector<int64_t>& stones, const std::vector<uint64_t>& horizons) {
+        std::vector<uint32_t> roots;
+        for (const auto& stone : stones) {
+            roots.push_back(closure_.add(stone));
+        }
+        extend_columns();
+        for (auto t : horizons) {
+            extend_rows(t);
+        }
+
+        std::vector<Count> result;
+        for (auto t : horizons) {
+            Count total = 0;
+            for (auto i : roots) total = plus(total, rows_[t][i]);
+            result.push_back(total);
+        }
+        return result;
+    }
+
+private:
+    // a + b, saturating at OVERFLOW on carry
+    static Count plus(Count a, Count b) {
+        Count sum = a + b;
+        return sum < a ? OVERFLOW : sum;
+    }
+
+    Count blink_once(const std::vector<Count>& prev, size_t i) const {
+        auto [first, second] = closure_.children[i];
+        return plus(prev[first], second == Closure::NONE ? 0 : prev[second]);
+    }
+
+    // Fill every existing row for values added since the last query
+    void extend_columns() {
+        size_t from = rows_.empty() ? 0 : rows_[0].size();
+        size_t to = closure_.values.size();
+        if (rows_.empty()) rows_.emplace_back();
+        rows_[0].resize(to, 1);
+        for (size_t t = 1; t < rows_.size(); ++t) {
+            rows_[t].resize(to);
+            for (size_t i = from; i < to; ++i) rows_[t][i] = blink_once(rows_[t - 1], i);
+        }
+    }
+
+    void extend_rows(uint64_t horizon) {
+        while (rows_.size() <= horizon) {
+            const auto& prev = rows_.back();
+            std::vector<Count> row(prev.size());
+            for (size_t i = 0; i < row.size(); ++i) row[i] = blink_once(prev, i);
+            rows_.push_back(std::move(row));
+        }
+    }
+
+    Closure closure_;
+    std::vector<std::vector<Count>> rows_;
+};
+
+// Write a table of every value reachable from 0..99 for 0..max_blinks blinks
+bool build_table(const char* path, uint32_t max_blinks) {
+    Closure closure;
+    for (int64_t stone = 0; stone < 100; ++stone) {
+        closure.add(stone);
+    }
+    std::vector<int64_t> values = closure.values;
+    std::sort(values.begin(), values.end());
+
+    std::string body(values.size() * (sizeof(int64_t) + (max_blinks + 1) * sizeof(uint64_t)), '\0');
+    std::memcpy(&body[0], values.data(), values.size() * sizeof(int64_t));
+    size_t at = values.size() * sizeof(int64_t);
+
+    Cache cache;
+    for (auto stone : values) {
+        for (uint32_t t = 0; t <= max_blinks; ++t) {
+            uint64_t count = count_len(stone, t, cache);
+            std::memcpy(&body[at], &count, sizeof(count));
+            at += sizeof(count);
+        }
+    }
+
+    TableHeader header{};
+    std::memcpy(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    header.version = TABLE_VERSION;
+    header.max_blinks = max_blinks;
+    header.num_values = values.size();
+    header.checksum = table_checksum(header, body.data(), body.size());
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(body.data(), static_cast<std::streamsize>(body.size()));
+    return static_cast<bool>(out);
+}
+
+std::string to_string(unsigned __int128 x) {
+    std::string s;
+    do {
+        s += static_cast<char>('0' + static_cast<int>(x % 10));
+        x /= 10;
+    } while (x > 0);
+    return {s.rbegin(), s.rend()};
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <input_file>" << std::endl;
+    // --memo: recursive memoized count_len instead of the iterative engine
+    // --blinks N,M,...: counts for the given horizons instead of 25 and 75,
+    // for every input line, exact in 128 bits or modulo the prime given with --mod
+    // --build-table F [--table-blinks N]: write a precomputed stone table and exit
+    // --table F: answer count_len from the table F where it can (implies --memo)
+    // -j N: threads for the sharded engine
+    bool memo = false;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint64_t> horizons;
+    uint64_t mod = 0;
+    const char* input = nullptr;
+    const char* table_path = nullptr;
+    const char* build_path = nullptr;
+    uint32_t table_blinks = 75;
+
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--memo") {
+            memo = true;
+        } else if (arg == "--blinks" && i + 1 < argc) {
+            std::istringstream list(argv[++i]);
+            std::string n;
+            while (std::getline(list, n, ',')) horizons.push_back(std::stoull(n));
+        } else if (arg == "--mod" && i + 1 < argc) {
+            mod = std::stoull(argv[++i]);
+            usage = !is_prime(mod) || mod >> 63;
+        } else if (arg == "--table" && i + 1 < argc) {
+            table_path = argv[++i];
+        } else if (arg == "--build-table" && i + 1 < argc) {
+            build_path = argv[++i];
+        } else if (arg == "--table-blinks" && i + 1 < argc) {
+            table_blinks = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        } else if (!input && arg.rfind("--", 0) != 0) {
+            input = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || (!input && !build_path)) {
+        std::cerr << "Usage: " << argv[0] << " <input_file> [--memo] [-j threads] [--blinks N,...] [--mod prime < 2^63] [--table file]\n"
+                  << "       " << argv[0] << " --build-table file [--table-blinks N]" << std::endl;
         return 1;
     }
 
-    std::ifstream file(argv[1]);
+    if (build_path) {
+        if (!build_table(build_path, table_blinks)) {
+            std::cerr << "Error: Could not write table." << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::unique_ptr<StoneTable> table;
+    if (table_path) {
+        table = std::make_unique<StoneTable>(table_path);
+        if (table->error()) {
+            std::cerr << "Ignoring stone table " << table_path << ": " << table->error() << std::endl;
+        } else {
+            stone_table = table.get();
+            memo = true;
+        }
+    }
+
+    std::ifstream file(input);
     if (!file.is_open()) {
         std::cerr << "Error: Could not open file." << std::endl;
         return 1;
     }
 
+    // Each input line is a batch of stones; only --blinks uses more than one
+    std::vector<std::vector<int64_t>> batches;
     std::string line;
-    std::getline(file, line);
-    std::istringstream iss(line);
-    std::vector<int64_t> stones;
-    int64_t value;
-    while (iss >> value) {
-        stones.push_back(value);
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::vector<int64_t> stones;
+        int64_t value;
+        while (iss >> value) {
+            stones.push_back(value);
+        }
+        batches.push_back(stones);
+    }
+    if (batches.empty()) {
+        batches.emplace_back();
+    }
+
+    if (!mod && !horizons.empty() && *std::max_element(horizons.begin(), horizons.end()) > MAX_EXACT_BLINKS) {
+        std::cerr << "Error: exact counts overflow 128 bits before " << MAX_EXACT_BLINKS
+                  << " blinks; use --mod <prime> for longer horizons." << std::endl;
+        return 1;
+    }
+
+    if (!horizons.empty()) {
+        // One answer per horizon, batch after batch, each batch queried
+        // against the closure and tables the earlier ones left warm
+        if (mod) {
+            ModBlinkCache cache(mod);
+            for (const auto& stones : batches) {
+                size_t id = cache.add(stones);
+                for (auto times : horizons) {
+                    std::cout << cache.total(id, times) << std::endl;
+                }
+            }
+        } else {
+            BlinkCache cache;
+            for (const auto& stones : batches) {
+                for (auto count : cache.query(stones, horizons)) {
+                    if (count == BlinkCache::OVERFLOW) {
+                        std::cerr << "Error: count does not fit in 128 bits; use --mod <prime>." << std::endl;
+                        return 1;
+                    }
+                    std::cout << to_string(count) << std::endl;
+                }
+            }
+        }
+        return 0;
     }
 
-    std::cout << run(stones, 25) << std::endl;
-    std::cout << run(stones, 75) << std::endl;
+    const auto& stones = batches[0];
+    auto engine = [&](int64_t times) {
+        if (memo) return run(stones, times);
+        return threads > 1 ? blink_sharded(stones, times, threads) : blink(stones, times);
+    };
+    std::cout << engine(25) << std::endl;
+    std::cout << engine(75) << std::endl;
 
     return 0;
 }
\ No newline at end of file
@@ -1,131 +1,562 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
-#include <queue>
+#include <array>
+#include <algorithm>
 #include <string>
-#include <numeric>
 #include <utility>
-#include <optional>
+#include <cstdint>
+#include <thread>
+#include <stdexcept>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-// Define Pos as a pair of integers
-using Pos = std::pair<int, int>;
+#include "../common/dense_grid.h"
 
-// Custom hash function for Pos
-struct PosHash {
-    std::size_t operator()(const Pos& pos) const {
-        return std::hash<int>()(pos.first) ^ (std::hash<int>()(pos.second) << 1);
+// Plant per cell; the border and any cells missing from short lines hold
+// OUTSIDE, which matches no plant
+constexpr char OUTSIDE = '\0';
+using Grid = DenseGrid<char>;
+
+// Fence contributions of one cell: edges facing another plant, and corners of
+// its region (a region has as many sides as corners)
+struct CellFence {
+    int peri = 0;
+    int corners = 0;
+};
+
+CellFence cell_fence(const Grid& grid, size_t pos) {
+    const ptrdiff_t up = -grid.stride, down = grid.stride;
+    char c = grid[pos];
+
+    bool top = grid[pos + up] == c;
+    bool right = grid[pos + 1] == c;
+    bool bottom = grid[pos + down] == c;
+    bool left = grid[pos - 1] == c;
+
+    CellFence fence;
+    fence.peri = !top + !right + !bottom + !left;
+
+    if (!top && !right) fence.corners++;
+    if (!top && !left) fence.corners++;
+    if (!bottom && !right) fence.corners++;
+    if (!bottom && !left) fence.corners++;
+
+    // Inner corners
+    if (top && right && grid[pos + up + 1] != c) fence.corners++;
+    if (bottom && right && grid[pos + down + 1] != c) fence.corners++;
+    if (bottom && left && grid[pos + down - 1] != c) fence.corners++;
+    if (top && left && grid[pos + up - 1] != c) fence.corners++;
+
+    return fence;
+}
+
+// Perimeter and corner counts of every cell of row y, into peri[x] and
+// corners[x]. The row is compared with its eight shifted neighbor rows 32
+// (AVX2) or 16 (SSE2) cells at a time; the padded border keeps every load in
+// bounds, and the tail (or everything, without SIMD) goes through cell_fence.
+void row_fence(const Grid& grid, int y, uint8_t* peri, uint8_t* corners) {
+    const size_t start = grid.index(y, 0);
+    int x = 0;
+
+#if defined(__AVX2__)
+    using Vec = __m256i;
+    constexpr int LANES = 32;
+    auto load = [](const char* p) { return _mm256_loadu_si256(reinterpret_cast<const Vec*>(p)); };
+    auto store = [](uint8_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<Vec*>(p), v); };
+    auto eq = [](Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); };
+    auto and_ = [](Vec a, Vec b) { return _mm256_and_si256(a, b); };
+    auto or_ = [](Vec a, Vec b) { return _mm256_or_si256(a, b); };
+    auto andnot = [](Vec a, Vec b) { return _mm256_andnot_si256(a, b); };
+    auto add = [](Vec a, Vec b) { return _mm256_add_epi8(a, b); };
+    const Vec one = _mm256_set1_epi8(1);
+#elif defined(__SSE2__)
+    using Vec = __m128i;
+    constexpr int LANES = 16;
+    auto load = [](const char* p) { return _mm_loadu_si128(reinterpret_cast<const Vec*>(p)); };
+    auto store = [](uint8_t* p, Vec v) { _mm_storeu_si128(reinterpret_cast<Vec*>(p), v); };
+    auto eq = [](Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); };
+    auto and_ = [](Vec a, Vec b) { return _mm_and_si128(a, b); };
+    auto or_ = [](Vec a, Vec b) { return _mm_or_si128(a, b); };
+    auto andnot = [](Vec a, Vec b) { return _mm_andnot_si128(a, b); };
+    auto add = [](Vec a, Vec b) { return _mm_add_epi8(a, b); };
+    const Vec one = _mm_set1_epi8(1);
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    const char* row = &grid[start];
+    const char* up = row - grid.stride;
+    const char* down = row + grid.stride;
+    for (; x + LANES <= grid.width; x += LANES) {
+        Vec c = load(row + x);
+        // 0xFF where the neighbor holds the same plant
+        Vec t = eq(c, load(up + x)), b = eq(c, load(down + x));
+        Vec l = eq(c, load(row + x - 1)), r = eq(c, load(row + x + 1));
+        Vec tl = eq(c, load(up + x - 1)), tr = eq(c, load(up + x + 1));
+        Vec bl = eq(c, load(down + x - 1)), br = eq(c, load(down + x + 1));
+
+        // andnot(m, one) is 1 where m is clear
+        Vec edges = add(add(andnot(t, one), andnot(b, one)), add(andnot(l, one), andnot(r, one)));
+        Vec outer = add(add(andnot(or_(t, r), one), andnot(or_(t, l), one)),
+                        add(andnot(or_(b, r), one), andnot(or_(b, l), one)));
+        Vec inner = add(add(and_(andnot(tr, and_(t, r)), one), and_(andnot(br, and_(b, r)), one)),
+                        add(and_(andnot(bl, and_(b, l)), one), and_(andnot(tl, and_(t, l)), one)));
+        store(peri + x, edges);
+        store(corners + x, add(outer, inner));
+    }
+#endif
+
+    for (; x < grid.width; ++x) {
+        auto fence = cell_fence(grid, start + x);
+        peri[x] = static_cast<uint8_t>(fence.peri);
+        corners[x] = static_cast<uint8_t>(fence.corners);
+    }
+}
+
+struct Region {
+    uint64_t area = 0;
+    uint64_t peri = 0;
+    uint64_t sides = 0;
+
+    Region& operator+=(const Region& other) {
+        area += other.area;
+        peri += other.peri;
+        sides += other.sides;
+        return *this;
     }
 };
 
-// Grid is a map of Pos to char
-using Grid = std::unordered_map<Pos, char, PosHash>;
-using CellSet = std::unordered_set<Pos, PosHash>;
+// Union-find over provisional region labels; each root holds its region's totals
+class Labels {
+public:
+    uint32_t make() {
+        parent_.push_back(static_cast<uint32_t>(parent_.size()));
+        regions_.emplace_back();
+        return parent_.back();
+    }
 
-struct Entry {
-    int area = 0;
-    int peri = 0;
-    CellSet cells;
+    uint32_t find(uint32_t label) {
+        while (parent_[label] != label) {
+            parent_[label] = parent_[parent_[label]];
+            label = parent_[label];
+        }
+        return label;
+    }
+
+    // Merge two regions; returns the surviving root
+    uint32_t unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return a;
+        if (regions_[a].area < regions_[b].area) std::swap(a, b);
+        parent_[b] = a;
+        regions_[a] += regions_[b];
+        return a;
+    }
+
+    // Append the labels of another set after ours; returns the offset added
+    // to its labels
+    uint32_t absorb(const Labels& other) {
+        auto offset = static_cast<uint32_t>(parent_.size());
+        for (auto p : other.parent_) parent_.push_back(p + offset);
+        regions_.insert(regions_.end(), other.regions_.begin(), other.regions_.end());
+        return offset;
+    }
+
+    Region& region(uint32_t root) { return regions_[root]; }
+    size_t size() const { return parent_.size(); }
+    bool is_root(uint32_t label) const { return parent_[label] == label; }
+
+private:
+    std::vector<uint32_t> parent_;
+    std::vector<Region> regions_;
 };
 
-// Flood-fill to find connected regions
-std::optional<Entry> flood_fill(const Pos& pos, const Grid& grid, CellSet& visited) {
-    if (visited.count(pos)) return std::nullopt;
-
-    char c = grid.at(pos);
-    std::queue<Pos> queue;
-    queue.push(pos);
-
-    Entry entry;
-    while (!queue.empty()) {
-        Pos current = queue.front();
-        queue.pop();
-
-        if (visited.count(current)) continue;
-
-        visited.insert(current);
-        entry.area++;
-        entry.cells.insert(current);
-
-        int y = current.first, x = current.second;
-        for (const auto& [dy, dx] : std::vector<Pos>{{-1, 0}, {1, 0}, {0, -1}, {0, 1}}) {
-            Pos neighbor = {y + dy, x + dx};
-            if (grid.find(neighbor) != grid.end()) {
-                if (grid.at(neighbor) != c) {
-                    entry.peri++;
-                } else if (!visited.count(neighbor)) {
-                    queue.push(neighbor);
-                }
+struct FenceCosts {
+    uint64_t by_perimeter = 0;
+    uint64_t by_sides = 0;
+};
+
+// Labels of the horizontal band [y0, y1), plus the labels of its first and
+// last rows for joining it to its neighbors
+struct Band {
+    int y0 = 0, y1 = 0;
+    Labels labels;
+    std::vector<uint32_t> first, last;
+};
+
+// Label one band in a row-major pass. Each cell joins the region of its left
+// and upper neighbors (within the band) when they hold the same plant,
+// merging the two if needed, and adds its own area, perimeter and corners to
+// it. Only the labels of the previous and current row are kept.
+void label_band(const Grid& grid, Band& band) {
+    auto& labels = band.labels;
+    std::vector<uint32_t> prev(grid.width), cur(grid.width);
+    std::vector<uint8_t> peri(grid.width), corners(grid.width);
+
+    for (int y = band.y0; y < band.y1; ++y) {
+        row_fence(grid, y, peri.data(), corners.data());
+        for (int x = 0; x < grid.width; ++x) {
+            size_t pos = grid.index(y, x);
+            char c = grid[pos];
+            if (c == OUTSIDE) continue;
+
+            bool left = x > 0 && grid[pos - 1] == c;
+            bool up = y > band.y0 && grid[pos - grid.stride] == c;
+
+            uint32_t label;
+            if (left && up) {
+                label = labels.unite(cur[x - 1], prev[x]);
+            } else if (left) {
+                label = labels.find(cur[x - 1]);
+            } else if (up) {
+                label = labels.find(prev[x]);
             } else {
-                entry.peri++;
+                label = labels.make();
             }
+
+            labels.region(label) += {1, peri[x], corners[x]};
+            cur[x] = label;
         }
+        if (y == band.y0) band.first = cur;
+        std::swap(prev, cur);
     }
-    return entry;
+    band.last = prev;
 }
 
-// Find all areas using flood-fill
-std::vector<Entry> find_areas(const Grid& grid) {
-    CellSet visited;
-    std::vector<Entry> entries;
+// Both fence costs in one pass. The garden is cut into horizontal bands that
+// are labeled on their own threads; the band label sets are then concatenated
+// and regions crossing each seam are united. Perimeter and corner counts only
+// depend on a cell's neighbors, so they are already correct at the seams.
+FenceCosts fence_costs(const Grid& grid, int threads) {
+    int count = std::max(1, std::min(threads, grid.height));
+    std::vector<Band> bands(count);
+    for (int b = 0; b < count; ++b) {
+        bands[b].y0 = static_cast<int>(static_cast<int64_t>(grid.height) * b / count);
+        bands[b].y1 = static_cast<int>(static_cast<int64_t>(grid.height) * (b + 1) / count);
+    }
 
-    for (const auto& [pos, _] : grid) {
-        if (visited.count(pos)) continue;
+    std::vector<std::thread> workers;
+    for (int b = 1; b < count; ++b) {
+        workers.emplace_back([&, b] { label_band(grid, bands[b]); });
+    }
+    label_band(grid, bands[0]);
+    for (auto& w : workers) w.join();
+
+    Labels labels;
+    std::vector<uint32_t> offset(count);
+    for (int b = 0; b < count; ++b) {
+        offset[b] = labels.absorb(bands[b].labels);
+    }
 
-        if (auto entry = flood_fill(pos, grid, visited)) {
-            entries.push_back(*entry);
+    for (int b = 1; b < count; ++b) {
+        const auto& above = bands[b - 1];
+        const auto& below = bands[b];
+        if (above.y0 == above.y1 || below.y0 == below.y1) continue;
+        for (int x = 0; x < grid.width; ++x) {
+            size_t pos = grid.index(below.y0, x);
+            char c = grid[pos];
+            if (c != OUTSIDE && grid[pos - grid.stride] == c) {
+                labels.unite(offset[b - 1] + above.last[x], offset[b] + below.first[x]);
+            }
         }
     }
-    return entries;
-}
 
-// Compute fence cost based on area and perimeter
-int compute_fence_cost1(const Grid& grid) {
-    auto areas = find_areas(grid);
-    return std::accumulate(areas.begin(), areas.end(), 0, [](int sum, const Entry& entry) {
-        return sum + entry.area * entry.peri;
-    });
+    FenceCosts costs;
+    for (uint32_t label = 0; label < labels.size(); ++label) {
+        if (!labels.is_root(label)) continue;
+        const auto& r = labels.region(label);
+        costs.by_perimeter += r.area * r.peri;
+        costs.by_sides += r.area * r.sides;
+    }
+    return costs;
 }
 
-// Compute a more complex fence cost considering corners and edge cases
-int compute_fence_cost2(const Grid& grid) {
-    auto areas = find_areas(grid);
-    int total_cost = 0;
+// Garden kept labeled under single-cell edits. Every cell stores its region
+// label and every region its totals, so an edit only touches the 3x3 window
+// around the cell (whose perimeter and corner counts can change) and the
+// regions it joins or leaves. The old region is only relabeled when removing
+// the cell actually splits it, and merged regions are folded into the largest.
+class Garden {
+public:
+    static constexpr uint32_t NO_LABEL = ~uint32_t(0);
+
+    explicit Garden(Grid grid) : grid_(std::move(grid)), label_(grid_.cells.size(), NO_LABEL), seen_(grid_.cells.size(), 0) {
+        std::vector<size_t> queue;
+        for (size_t pos = 0; pos < grid_.cells.size(); ++pos) {
+            if (grid_[pos] == OUTSIDE || label_[pos] != NO_LABEL) continue;
 
-    for (const auto& area : areas) {
-        int sides = 0;
-        for (const auto& pos : area.cells) {
-            int y = pos.first, x = pos.second;
-            char c = grid.at(pos);
-            char default_char = '2';
+            uint32_t label = new_label();
+            label_[pos] = label;
+            queue.assign(1, pos);
+            for (size_t head = 0; head < queue.size(); ++head) {
+                size_t cur = queue[head];
+                add_cell(label, cur);
+                for (auto d : grid_.directions()) {
+                    size_t n = cur + d;
+                    if (grid_[n] == grid_[pos] && label_[n] == NO_LABEL) {
+                        label_[n] = label;
+                        queue.push_back(n);
+                    }
+                }
+            }
+        }
+        settle();
+    }
 
-            char top = grid.count({y - 1, x}) ? grid.at({y - 1, x}) : default_char;
-            char right = grid.count({y, x + 1}) ? grid.at({y, x + 1}) : default_char;
-            char bottom = grid.count({y + 1, x}) ? grid.at({y + 1, x}) : default_char;
-            char left = grid.count({y, x - 1}) ? grid.at({y, x - 1}) : default_char;
+    FenceCosts costs() const { return costs_; }
 
-            if (top != c && right != c) sides++;
-            if (top != c && left != c) sides++;
-            if (bottom != c && right != c) sides++;
-            if (bottom != c && left != c) sides++;
+    // Plant c at (y, x) and return the updated costs
+    FenceCosts set(int y, int x, char c) {
+        if (y < 0 || y >= grid_.height || x < 0 || x >= grid_.width || c == OUTSIDE) {
+            throw std::out_of_range("Edit outside the garden");
+        }
+        size_t pos = grid_.index(y, x);
+        char old = grid_[pos];
+        if (old == c) return costs_;
 
-            // Corners
-            if (top == c && right == c && (!grid.count({y - 1, x + 1}) || grid.at({y - 1, x + 1}) != c)) sides++;
-            if (bottom == c && right == c && (!grid.count({y + 1, x + 1}) || grid.at({y + 1, x + 1}) != c)) sides++;
-            if (bottom == c && left == c && (!grid.count({y + 1, x - 1}) || grid.at({y + 1, x - 1}) != c)) sides++;
-            if (top == c && left == c && (!grid.count({y - 1, x - 1}) || grid.at({y - 1, x - 1}) != c)) sides++;
+        // The window's fence counts are taken out, the cell changes, and the
+        // neighbors' counts go back in with their new values
+        std::array<size_t, 8> window;
+        size_t n = 0;
+        for (ptrdiff_t dy : {-grid_.stride, ptrdiff_t(0), grid_.stride}) {
+            for (ptrdiff_t dx : {-1, 0, 1}) {
+                if (dy || dx) window[n++] = pos + dy + dx;
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (label_[window[i]] != NO_LABEL) remove_fence(label_[window[i]], window[i]);
         }
-        total_cost += area.area * sides;
+        uint32_t old_label = label_[pos];
+        if (old_label != NO_LABEL) {
+            remove_cell(old_label, pos);
+            label_[pos] = NO_LABEL;
+        }
+        grid_[pos] = c;
+        for (size_t i = 0; i < n; ++i) {
+            if (label_[window[i]] != NO_LABEL) add_fence(label_[window[i]], window[i]);
+        }
+
+        if (old_label != NO_LABEL) split(old_label, pos);
+        join(pos);
+
+        settle();
+        return costs_;
     }
 
-    return total_cost;
-}
+private:
+    // Add the costs of the touched regions back and recycle emptied labels
+    void settle() {
+        for (auto label : touched_) {
+            const auto& r = regions_[label];
+            costs_.by_perimeter += r.area * r.peri;
+            costs_.by_sides += r.area * r.sides;
+            is_touched_[label] = false;
+            if (r.area == 0) free_.push_back(label);
+        }
+        touched_.clear();
+    }
+
+    // Take a region's cost out of the totals before its first change in an
+    // edit; it is added back once the edit is done
+    void touch(uint32_t label) {
+        if (is_touched_[label]) return;
+        is_touched_[label] = true;
+        touched_.push_back(label);
+        const auto& r = regions_[label];
+        costs_.by_perimeter -= r.area * r.peri;
+        costs_.by_sides -= r.area * r.sides;
+    }
+
+    uint32_t new_label() {
+        uint32_t label;
+        if (!free_.empty()) {
+            label = free_.back();
+            free_.pop_back();
+        } else {
+            label = static_cast<uint32_t>(regions_.size());
+            regions_.emplace_back();
+            is_touched_.push_back(false);
+        }
+        regions_[label] = {};
+        return label;
+    }
+
+    void add_fence(uint32_t label, size_t pos) {
+        touch(label);
+        auto f = cell_fence(grid_, pos);
+        regions_[label].peri += f.peri;
+        regions_[label].sides += f.corners;
+    }
+
+    void remove_fence(uint32_t label, size_t pos) {
+        touch(label);
+        auto f = cell_fence(grid_, pos);
+        regions_[label].peri -= f.peri;
+        regions_[label].sides -= f.corners;
+    }
+
+    void add_cell(uint32_t label, size_t pos) {
+        add_fence(label, pos);
+        regions_[label].area++;
+    }
+
+    void remove_cell(uint32_t label, size_t pos) {
+        remove_fence(label, pos);
+        regions_[label].area--;
+    }
+
+    // The cell at pos left region `label`. Search from each of its former
+    // neighbors in the region in lockstep, uniting searches that meet; a group
+    // of searches that runs out of cells without meeting the rest has found a
+    // piece that was cut off and gets a new label.
+    void split(uint32_t label, size_t pos) {
+        std::array<std::vector<size_t>, 4> found;
+        std::array<size_t, 4> head{};
+        std::array<int, 4> group{};
+        int searches = 0;
+        for (auto d : grid_.directions()) {
+            if (label_[pos + d] == label) {
+                found[searches].assign(1, pos + d);
+                group[searches] = searches;
+                ++searches;
+            }
+        }
+        if (searches < 2) return;
+
+        // seen_[cell] - stamp_ is the search that reached it
+        if (stamp_ > ~uint32_t(0) - 8) {
+            std::fill(seen_.begin(), seen_.end(), 0);
+            stamp_ = 0;
+        }
+        uint32_t base = stamp_ + 1;
+        stamp_ += 4;
+        for (int i = 0; i < searches; ++i) seen_[found[i][0]] = base + i;
+
+        auto root = [&](int i) {
+            while (group[i] != i) i = group[i];
+            return i;
+        };
+        int groups = searches;
+        std::array<bool, 4> done{};
+
+        while (groups > 1) {
+            for (int i = 0; i < searches && groups > 1; ++i) {
+                if (done[root(i)] || head[i] == found[i].size()) continue;
+                size_t cur = found[i][head[i]++];
+                for (auto d : grid_.directions()) {
+                    size_t n = cur + d;
+                    if (label_[n] != label) continue;
+                    if (seen_[n] >= base && seen_[n] < base + 4) {
+                        int a = root(i), b = root(static_cast<int>(seen_[n] - base));
+                        if (a != b) {
+                            group[b] = a;
+                            --groups;
+                        }
+                    } else {
+                        seen_[n] = base + i;
+                        found[i].push_back(n);
+                    }
+                }
+            }
+
+            // A group with every search exhausted is a separate piece
+            for (int g = 0; g < searches && groups > 1; ++g) {
+                if (root(g) != g || done[g]) continue;
+                bool exhausted = true;
+                for (int i = 0; i < searches; ++i) {
+                    if (root(i) == g && head[i] < found[i].size()) exhausted = false;
+                }
+                if (!exhausted) continue;
+
+                uint32_t piece = new_label();
+                for (int i = 0; i < searches; ++i) {
+                    if (root(i) != g) continue;
+                    for (auto cell : found[i]) {
+                        remove_cell(label, cell);
+                        add_cell(piece, cell);
+                        label_[cell] = piece;
+                    }
+                }
+                done[g] = true;
+                --groups;
+            }
+        }
+    }
+
+    // The cell at pos joins its same-plant neighbors, folding their regions
+    // into the largest of them
+    void join(size_t pos) {
+        char c = grid_[pos];
+        uint32_t target = NO_LABEL;
+        for (auto d : grid_.directions()) {
+            uint32_t label = grid_[pos + d] == c ? label_[pos + d] : NO_LABEL;
+            if (label != NO_LABEL && (target == NO_LABEL || regions_[label].area > regions_[target].area)) {
+                target = label;
+            }
+        }
+        if (target == NO_LABEL) target = new_label();
+
+        for (auto d : grid_.directions()) {
+            uint32_t label = grid_[pos + d] == c ? label_[pos + d] : NO_LABEL;
+            if (label == NO_LABEL || label == target) continue;
+
+            touch(label);
+            touch(target);
+            regions_[target] += regions_[label];
+            regions_[label] = {};
+
+            std::vector<size_t> queue{pos + d};
+            label_[pos + d] = target;
+            for (size_t head = 0; head < queue.size(); ++head) {
+                for (auto e : grid_.directions()) {
+                    size_t n = queue[head] + e;
+                    if (label_[n] == label) {
+                        label_[n] = target;
+                        queue.push_back(n);
+                    }
+                }
+            }
+        }
+
+        label_[pos] = target;
+        add_cell(target, pos);
+    }
+
+    Grid grid_;
+    std::vector<uint32_t> label_;
+    std::vector<Region> regions_;
+    std::vector<uint32_t> free_;
+    FenceCosts costs_;
+
+    std::vector<uint32_t> touched_;
+    std::vector<bool> is_touched_;
+    std::vector<uint32_t> seen_;
+    uint32_t stamp_ = 0;
+};
 
 // Main function
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <input_file>" << std::endl;
+    // --edits F: after the two costs, apply each "y x plant" line of F and
+    // print both costs after it
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* edits = nullptr;
+    bool usage = argc < 2;
+    for (int i = 2; i < argc && !usage; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--edits" && i + 1 < argc) {
+            edits = argv[++i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage) {
+        std::cerr << "Usage: " << argv[0] << " <input_file> [-j threads] [--edits file]" << std::endl;
         return 1;
     }
 
@@ -135,19 +566,39 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    Grid grid;
+    std::vector<std::string> lines;
     std::string line;
-    int y = 0;
-
+    size_t width = 0;
     while (std::getline(file, line)) {
-        for (int x = 0; x < line.size(); ++x) {
-            grid[{y, x}] = line[x];
+        width = std::max(width, line.size());
+        lines.push_back(line);
+    }
+
+    Grid grid(static_cast<int>(lines.size()), static_cast<int>(width), OUTSIDE);
+    for (int y = 0; y < grid.height; ++y) {
+        for (int x = 0; x < static_cast<int>(lines[y].size()); ++x) {
+            grid[grid.index(y, x)] = lines[y][x];
         }
-        ++y;
     }
 
-    std::cout << compute_fence_cost1(grid) << std::endl;
-    std::cout << compute_fence_cost2(grid) << std::endl;
+    auto costs = fence_costs(grid, threads);
+    std::cout << costs.by_perimeter << std::endl;
+    std::cout << costs.by_sides << std::endl;
+
+    if (edits) {
+        std::ifstream edit_file(edits);
+        if (!edit_file.is_open()) {
+            std::cerr << "Error: Could not open file." << std::endl;
+            return 1;
+        }
+        Garden garden(std::move(grid));
+        int y, x;
+        char c;
+        while (edit_file >> y >> x >> c) {
+            auto updated = garden.set(y, x, c);
+            std::cout << updated.by_perimeter << " " << updated.by_sides << std::endl;
+        }
+    }
 
     return 0;
 }
\ No newline at end of file
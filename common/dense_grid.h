@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Row-major grid with a one-cell border of `fill` around the input, so every
+// inner cell's neighbors are at fixed index offsets
+template <class T>
+struct DenseGrid {
+    int height = 0, width = 0;
+    ptrdiff_t stride = 0;
+    std::vector<T> cells;
+
+    DenseGrid() = default;
+    DenseGrid(int height, int width, T fill)
+        : height(height), width(width), stride(width + 2),
+          cells(static_cast<size_t>(height + 2) * (width + 2), fill) {}
+
+    size_t index(int y, int x) const { return (y + 1) * stride + (x + 1); }
+    T& operator[](size_t i) { return cells[i]; }
+    const T& operator[](size_t i) const { return cells[i]; }
+
+    // Offsets to the up, right, down and left neighbors
+    std::array<ptrdiff_t, 4> directions() const { return {-stride, 1, stride, -1}; }
+};
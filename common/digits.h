@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Powers of ten, 10^0 .. 10^19
+constexpr std::array<uint64_t, 20> POW10 = [] {
+    std::array<uint64_t, 20> p{};
+    p[0] = 1;
+    for (size_t i = 1; i < p.size(); ++i) p[i] = p[i - 1] * 10;
+    return p;
+}();
+
+// Number of decimal digits (0 has one digit)
+constexpr uint32_t digits(uint64_t x) {
+    x |= 1;
+    // floor(log10(x)) estimated from the bit width (1233/4096 ~ log10(2)), then corrected
+    uint32_t d = ((64 - __builtin_clzll(x)) * 1233) >> 12;
+    return d + (x >= POW10[d]);
+}